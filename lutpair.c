@@ -0,0 +1,6521 @@
+// lutpair.c
+// DS_bighw: Parse design_*.v netlists and pair LUTs into GTP_LUT6D cells.
+// The engine behind lutpair.h: parsing, indexing, the pairing strategies and
+// matchers, the writers, and the command-line drivers main.c calls.
+//
+// Requirements implemented:
+// - Parse design_*.v files in current directory.
+// - Recognize only module instances whose cell/module name matches GTP_LUT<digits>
+//   but exclude GTP_LUT6CARRY.
+// - For each recognized LUT instance, collect input nets from ports .I<number>(net)
+//   ignoring .Z (and other ports).
+// - Greedily pair LUTs such that the combined set of unique input nets has size <= 6.
+//   Each LUT used at most once.
+// - Write output file design_x_syn.res per testcase in expected format:
+//     <pair_count>\n
+//     <inst1> <inst2>\n   for each pair
+//     (If odd LUT remains unpaired, it is ignored; pair_count counts only pairs.)
+// - Print per-testcase summary including wall time and peak RSS (process-wide,
+//   so it covers every testcase that has run so far).
+//
+// Notes/assumptions:
+// - This is a lightweight parser intended for typical synthesized Verilog netlists:
+//     GTP_LUT6 u1 ( .I0(n1), .I1(n2), .Z(nout) );
+//     GTP_LUT6 #( .INIT(64'h...) ) u1 ( ... );
+//   Instance name is the identifier after the cell name and optional
+//   parameter block; INIT is kept as a 64-bit truth table.
+// - Nets can be simple identifiers or escaped identifiers (\\name) and may include
+//   bit selects like bus[3]. We capture text inside parentheses up to matching ')'
+//   (no nested parentheses expected).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <time.h>
+
+#include "lutpair.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#define LUTPAIR_THREADS 1
+#define LUTPAIR_SOCKETS 1
+#endif
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define LUTPAIR_PERF 1
+#endif
+
+#ifndef MAX
+#define MAX(a,b) ((a)>(b)?(a):(b))
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LUTPAIR_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+// Hot-path counters, compiled in with -DLUTPAIR_STATS and reported by
+// --stats=json. Without the flag STAT_ADD/STAT_MAX expand to nothing.
+// Counters are process-wide relaxed atomics (graph rows are built on
+// several threads); with --stats testcases run one at a time, so each
+// report covers exactly one run.
+#ifdef LUTPAIR_STATS
+typedef struct {
+    uint64_t union_calls;       // union_unique_count_le6, and first-fit's size-bucket picks
+    uint64_t union_fast;        // ... accepted on n_a + n_b <= 6 alone (every bucket pick)
+    uint64_t sig_rejects;       // ... rejected by the signatures alone
+    uint64_t union_rejects;     // ... rejected: union of inputs > 6, or levels apart
+    uint64_t candidates;        // partner LUTs examined by first-fit and the graph build
+    uint64_t candidate_luts;    // LUTs whose partners were examined
+    uint64_t parse_bytes;
+    uint64_t tokens;            // identifiers parsed
+    uint64_t net_lookups;       // net_intern / net_lookup calls
+    uint64_t net_probes;        // slots visited by them
+    uint64_t net_max_probe;
+    uint64_t arena_bytes;
+} HotStats;
+
+static HotStats hot_stats;
+#define STAT_ADD(field, v) ((void)__atomic_fetch_add(&hot_stats.field, (uint64_t)(v), __ATOMIC_RELAXED))
+#define STAT_MAX(field, v) do { \
+        uint64_t v_ = (uint64_t)(v), o_ = __atomic_load_n(&hot_stats.field, __ATOMIC_RELAXED); \
+        while (v_ > o_ && !__atomic_compare_exchange_n(&hot_stats.field, &o_, v_, 1, \
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {} \
+    } while (0)
+#else
+#define STAT_ADD(field, v) ((void)0)
+#define STAT_MAX(field, v) ((void)0)
+#endif
+
+#define LUT_MAX_INPUTS 6
+#define LUT_TOO_WIDE   (LUT_MAX_INPUTS + 1)  // more unique inputs than a LUT6D can take
+#define NET_ID_PAD     0xFFFFFFFFu           // fills unused in[] slots; never a real ID
+
+typedef struct {
+    char *inst;                    // instance name
+    uint32_t in[LUT_MAX_INPUTS];   // unique input net IDs, ascending, NET_ID_PAD-padded
+    uint64_t init;                 // INIT parameter (truth table), if has_init
+    uint8_t n;                     // number of IDs in `in`, or LUT_TOO_WIDE
+    uint8_t used;
+    uint8_t has_init;
+    uint8_t leveled;               // level/slack set: pairs must be depth_compatible (--preserve-depth)
+    uint16_t level;                // logic level (1 = fed by registers/pads), see levelize
+    uint16_t slack;                // levels this LUT may move without lengthening the critical path
+    uint64_t sig;                  // one bit per input ID, see lut_signature
+} Lut;
+
+static void *xmalloc(size_t n) {
+    void *p = malloc(n);
+    if (!p) { fprintf(stderr, "OOM\n"); exit(1); }
+    return p;
+}
+
+static void *xrealloc(void *p, size_t n) {
+    p = realloc(p, n);
+    if (!p) { fprintf(stderr, "OOM\n"); exit(1); }
+    return p;
+}
+
+// Bump allocator for parse-time objects that live exactly as long as one
+// netlist (instance names, scratch copies). Allocation is a pointer bump
+// inside a chunk; everything is released at once by arena_free.
+#ifndef ARENA_CHUNK_SIZE
+#define ARENA_CHUNK_SIZE (64u << 10)
+#endif
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk *chunks;   // most recent first
+    char *cur;
+    char *end;
+} Arena;
+
+static void arena_init(Arena *a) {
+    a->chunks = NULL;
+    a->cur = a->end = NULL;
+}
+
+static void arena_free(Arena *a) {
+    ArenaChunk *c = a->chunks;
+    while (c) {
+        ArenaChunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    arena_init(a);
+}
+
+static void *arena_alloc(Arena *a, size_t n) {
+    n = (n + 7) & ~(size_t)7;
+    STAT_ADD(arena_bytes, n);
+    if ((size_t)(a->end - a->cur) < n) {
+        // Oversized requests get a chunk of their own.
+        size_t size = n > ARENA_CHUNK_SIZE / 4 ? n : ARENA_CHUNK_SIZE;
+        ArenaChunk *c = (ArenaChunk*)xmalloc(sizeof(ArenaChunk) + size);
+        c->next = a->chunks;
+        a->chunks = c;
+        a->cur = (char*)(c + 1);
+        a->end = a->cur + size;
+    }
+    void *p = a->cur;
+    a->cur += n;
+    return p;
+}
+
+static char *arena_strndup(Arena *a, const char *s, size_t len) {
+    char *out = (char*)arena_alloc(a, len + 1);
+    memcpy(out, s, len);
+    out[len] = '\0';
+    return out;
+}
+
+// Non-owning view of a token inside the input buffer.
+typedef struct {
+    const char *s;
+    size_t len;
+} Token;
+
+// Net-name intern table for one netlist: every distinct net string gets a
+// dense uint32_t ID. Names live back to back (NUL-terminated) in one byte
+// arena; lookup is open addressing with linear probing over `slots`, which
+// hold id + 1 (0 = empty). The table is kept at most half full.
+typedef struct {
+    char *bytes;        // name arena
+    size_t bytes_len;
+    size_t bytes_cap;
+    uint32_t *offs;     // id -> offset of the name in bytes
+    uint32_t *hash;     // id -> full hash, so rehashing never touches bytes
+    uint32_t count;
+    uint32_t cap;       // capacity of offs/hash
+    uint32_t *slots;
+    uint32_t mask;      // slot count - 1 (power of two)
+} NetTable;
+
+static uint32_t hash_bytes(const char *s, size_t len) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void net_table_init(NetTable *t) {
+    memset(t, 0, sizeof(*t));
+    t->mask = 1023;
+    t->slots = (uint32_t*)calloc((size_t)t->mask + 1, sizeof(uint32_t));
+    if (!t->slots) { fprintf(stderr, "OOM\n"); exit(1); }
+}
+
+static void net_table_free(NetTable *t) {
+    free(t->bytes);
+    free(t->offs);
+    free(t->hash);
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+
+static void net_table_grow(NetTable *t) {
+    uint32_t mask = t->mask * 2 + 1;
+    uint32_t *slots = (uint32_t*)calloc((size_t)mask + 1, sizeof(uint32_t));
+    if (!slots) { fprintf(stderr, "OOM\n"); exit(1); }
+    for (uint32_t id = 0; id < t->count; id++) {
+        uint32_t k = t->hash[id] & mask;
+        while (slots[k]) k = (k + 1) & mask;
+        slots[k] = id + 1;
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->mask = mask;
+}
+
+static uint32_t net_lookup(const NetTable *t, const char *s, size_t len) {
+    // Returns the ID of s, or NET_ID_PAD if it was never interned.
+    uint32_t h = hash_bytes(s, len);
+    STAT_ADD(net_lookups, 1);
+    for (uint32_t k = h & t->mask; t->slots[k]; k = (k + 1) & t->mask) {
+        STAT_ADD(net_probes, 1);
+        uint32_t id = t->slots[k] - 1;
+        if (t->hash[id] != h) continue;
+        const char *name = t->bytes + t->offs[id];
+        if (strncmp(name, s, len) == 0 && name[len] == '\0') return id;
+    }
+    return NET_ID_PAD;
+}
+
+static uint32_t net_intern(NetTable *t, const char *s, size_t len) {
+    uint32_t h = hash_bytes(s, len);
+    uint32_t k = h & t->mask;
+#ifdef LUTPAIR_STATS
+    uint32_t k0 = k;
+    STAT_ADD(net_lookups, 1);
+#endif
+    for (;;) {
+        uint32_t v = t->slots[k];
+        if (!v) break;
+        uint32_t id = v - 1;
+        if (t->hash[id] == h) {
+            const char *name = t->bytes + t->offs[id];
+            if (strncmp(name, s, len) == 0 && name[len] == '\0') {
+                STAT_ADD(net_probes, ((k - k0) & t->mask) + 1);
+                STAT_MAX(net_max_probe, ((k - k0) & t->mask) + 1);
+                return id;
+            }
+        }
+        k = (k + 1) & t->mask;
+    }
+    STAT_ADD(net_probes, ((k - k0) & t->mask) + 1);
+    STAT_MAX(net_max_probe, ((k - k0) & t->mask) + 1);
+
+    if (t->bytes_len + len + 1 > UINT32_MAX || t->count == NET_ID_PAD) {
+        fprintf(stderr, "Net table exceeds 4 GiB\n");
+        exit(1);
+    }
+    if (t->bytes_len + len + 1 > t->bytes_cap) {
+        size_t cap = t->bytes_cap ? t->bytes_cap : 4096;
+        while (cap < t->bytes_len + len + 1) cap *= 2;
+        t->bytes = (char*)xrealloc(t->bytes, cap);
+        t->bytes_cap = cap;
+    }
+    if (t->count == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 1024;
+        t->offs = (uint32_t*)xrealloc(t->offs, (size_t)t->cap * sizeof(uint32_t));
+        t->hash = (uint32_t*)xrealloc(t->hash, (size_t)t->cap * sizeof(uint32_t));
+    }
+
+    uint32_t id = t->count++;
+    t->offs[id] = (uint32_t)t->bytes_len;
+    t->hash[id] = h;
+    memcpy(t->bytes + t->bytes_len, s, len);
+    t->bytes[t->bytes_len + len] = '\0';
+    t->bytes_len += len + 1;
+    t->slots[k] = id + 1;
+
+    if ((uint64_t)t->count * 2 > (uint64_t)t->mask + 1) net_table_grow(t);
+    return id;
+}
+
+static uint32_t lut_add_net_unique(Lut *l, NetTable *nets, const char *net, size_t len) {
+    // Returns the net's ID, or NET_ID_PAD if nothing was recorded.
+    // trim spaces
+    const char *end = net + len;
+    while (net < end && isspace((unsigned char)*net)) net++;
+    while (end > net && isspace((unsigned char)end[-1])) end--;
+    if (end <= net) return NET_ID_PAD;
+    if (l->n == LUT_TOO_WIDE) return NET_ID_PAD;
+
+    uint32_t id = net_intern(nets, net, (size_t)(end - net));
+
+    // check existing
+    for (int i = 0; i < l->n; i++) {
+        if (l->in[i] == id) return id;
+    }
+
+    if (l->n == LUT_MAX_INPUTS) {
+        l->n = LUT_TOO_WIDE;
+        return NET_ID_PAD;
+    }
+    l->in[l->n++] = id;
+    return id;
+}
+
+static void lut_sort_inputs(Lut *l) {
+    // Insertion sort; at most six elements.
+    if (l->n > LUT_MAX_INPUTS) return;
+    for (int i = 1; i < l->n; i++) {
+        uint32_t v = l->in[i];
+        int k = i - 1;
+        while (k >= 0 && l->in[k] > v) { l->in[k + 1] = l->in[k]; k--; }
+        l->in[k + 1] = v;
+    }
+}
+
+static int is_gtp_lut_cell(Token cell) {
+    // must be exactly GTP_LUT<digits>; GTP_LUT6CARRY fails the digit test
+    if (cell.len < 8 || memcmp(cell.s, "GTP_LUT", 7) != 0) return 0;
+    for (size_t i = 7; i < cell.len; i++) {
+        if (!isdigit((unsigned char)cell.s[i])) return 0;
+    }
+    return 1;
+}
+
+static int is_ident_char(int c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+static const char *skip_comment(const char *p, const char *end) {
+    // p points at '/'. Returns the position after a // or /* */ comment,
+    // or p itself if no comment starts here. Unterminated comments run to end.
+    if (end - p < 2) return p;
+    if (p[1] == '/') {
+        const char *nl = (const char*)memchr(p + 2, '\n', (size_t)(end - p - 2));
+        return nl ? nl : end;
+    }
+    if (p[1] == '*') {
+        p += 2;
+        while (end - p >= 2) {
+            if (p[0] == '*' && p[1] == '/') return p + 2;
+            p++;
+        }
+        return end;
+    }
+    return p;
+}
+
+static void skip_spaces(const char **pp, const char *end) {
+    // Skips whitespace and comments; the input is never modified in place.
+    const char *p = *pp;
+    while (p < end) {
+        if (isspace((unsigned char)*p)) { p++; continue; }
+        if (*p == '/') {
+            const char *q = skip_comment(p, end);
+            if (q != p) { p = q; continue; }
+        }
+        break;
+    }
+    *pp = p;
+}
+
+static int starts_with(const char *p, const char *lit) {
+    while (*lit) {
+        if (*p++ != *lit++) return 0;
+    }
+    return 1;
+}
+
+static const char *find_any4(const char *p, const char *end, char a, char b, char c, char d) {
+    // Returns the first byte in [p, end) equal to a, b, c or d, or end.
+    // Repeat a delimiter to search for fewer. SSE2 is part of the x86-64
+    // baseline, so this needs no runtime dispatch.
+#if defined(LUTPAIR_X86_DISPATCH) && defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c), vd = _mm_set1_epi8(d);
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)p);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(x, vc), _mm_cmpeq_epi8(x, vd)));
+        int bits = _mm_movemask_epi8(m);
+        if (bits) return p + __builtin_ctz((unsigned)bits);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != a && *p != b && *p != c && *p != d) p++;
+    return p;
+}
+
+static const char *skip_statement(const char *p, const char *end) {
+    // Returns the position after the next ';' outside comments, escaped
+    // identifiers and strings.
+    for (;;) {
+        p = find_any4(p, end, ';', '/', '\\', '"');
+        if (p >= end) return end;
+        if (*p == ';') return p + 1;
+        if (*p == '/') {
+            const char *q = skip_comment(p, end);
+            p = q != p ? q : p + 1;
+        } else if (*p == '\\') {
+            while (p < end && !isspace((unsigned char)*p)) p++;
+        } else {
+            p++;
+            while (p < end && *p != '"') p += (*p == '\\' && p + 1 < end) ? 2 : 1;
+            if (p < end) p++;
+        }
+    }
+}
+
+static int parse_identifier(const char **pp, const char *end, Token *tok) {
+    // Parses Verilog identifier or escaped identifier into a view of the
+    // input; nothing is allocated. Escaped identifier: \\...<space>
+    const char *p = *pp;
+    skip_spaces(&p, end);
+    if (p >= end) return 0;
+
+    if (*p == '\\') {
+        STAT_ADD(tokens, 1);
+        const char *s = p;
+        p++; // consume backslash
+        while (p < end && !isspace((unsigned char)*p)) p++;
+        tok->s = s;
+        tok->len = (size_t)(p - s);
+        *pp = p;
+        return 1;
+    }
+
+    if (!is_ident_char((unsigned char)*p)) return 0;
+    STAT_ADD(tokens, 1);
+    const char *s = p;
+    while (p < end && is_ident_char((unsigned char)*p)) p++;
+    // allow hierarchical names a/b? In netlists, instance names may be simple.
+    // We'll stop at first non-ident.
+    tok->s = s;
+    tok->len = (size_t)(p - s);
+    *pp = p;
+    return 1;
+}
+
+static char *read_entire_file(const char *path, long *out_len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    if (fseek(f, 0, SEEK_END) != 0) { fclose(f); return NULL; }
+    long n = ftell(f);
+    if (n < 0) { fclose(f); return NULL; }
+    rewind(f);
+    char *buf = (char*)xmalloc((size_t)n + 1);
+    size_t rd = fread(buf, 1, (size_t)n, f);
+    fclose(f);
+    buf[rd] = '\0';
+    if (out_len) *out_len = (long)rd;
+    return buf;
+}
+
+static uint32_t atomic_add_u32(uint32_t *p, uint32_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#else
+    uint32_t old = *p; // single-threaded builds only
+    *p = old + v;
+    return old;
+#endif
+}
+
+static uint32_t temp_seq;
+
+static void temp_path_for(const char *path, char *tmp, size_t cap) {
+    // Outputs are written to a temporary next to `path` and renamed. The
+    // name is unique per process and per call: serve answers concurrent
+    // queries for one output, and each must rename a file of its own.
+#if defined(__unix__) || defined(__APPLE__)
+    snprintf(tmp, cap, "%s.%ld.%u.tmp", path, (long)getpid(), atomic_add_u32(&temp_seq, 1));
+#else
+    snprintf(tmp, cap, "%s.%u.tmp", path, atomic_add_u32(&temp_seq, 1));
+#endif
+}
+
+// Read-only view of a whole input file. On POSIX the file is mapped with
+// mmap so the parser works directly on the page cache; elsewhere (or when
+// mapping fails) it falls back to read_entire_file.
+typedef struct {
+    const char *data;
+    size_t len;
+    int mapped;     // 1: mmap; 0: malloc'd copy; -1: the caller's buffer, never freed
+} Source;
+
+static int source_open(Source *src, const char *path) {
+    src->data = NULL;
+    src->len = 0;
+    src->mapped = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        if (st.st_size == 0) {
+            close(fd);
+            src->data = "";
+            return 1;
+        }
+        void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            close(fd);
+#ifdef MADV_SEQUENTIAL
+            madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+            src->data = (const char*)m;
+            src->len = (size_t)st.st_size;
+            src->mapped = 1;
+            return 1;
+        }
+    }
+    close(fd);
+#endif
+    long n = 0;
+    char *buf = read_entire_file(path, &n);
+    if (!buf) return 0;
+    src->data = buf;
+    src->len = (size_t)n;
+    return 1;
+}
+
+static void source_close(Source *src) {
+    if (src->mapped < 0) {
+        src->data = NULL;
+        return;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    if (src->mapped) {
+        munmap((void*)src->data, src->len);
+        src->data = NULL;
+        return;
+    }
+#endif
+    if (src->len) free((void*)src->data);
+    src->data = NULL;
+}
+
+static const char *scan_net_end(const char *p, const char *end, int *has_comment) {
+    // Finds the ')' closing a port connection, stepping over comments.
+    *has_comment = 0;
+    for (;;) {
+        p = find_any4(p, end, ')', '/', ')', '/');
+        if (p >= end || *p == ')') return p;
+        const char *q = skip_comment(p, end);
+        if (q != p) { *has_comment = 1; p = q; }
+        else p++;
+    }
+}
+
+static int parse_verilog_int(const char *p, const char *end, uint64_t *out) {
+    // Parses a Verilog integer literal: 64'hFFFF_0000..., 8'h04, 'b1010,
+    // 32'd570425348 or plain decimal. Only the low 64 bits are kept, and
+    // x/z/? digits read as 0. Returns 0 if this is not an integer literal.
+    skip_spaces(&p, end);
+    const char *s = p;
+    while (p < end && (isdigit((unsigned char)*p) || *p == '_')) p++;
+    const char *size_end = p;
+    skip_spaces(&p, end);
+    int base = 10;
+    if (p < end && *p == '\'') {
+        p++;
+        if (p < end && (*p == 's' || *p == 'S')) p++;
+        if (p >= end) return 0;
+        switch (*p | 0x20) {
+        case 'h': base = 16; break;
+        case 'd': base = 10; break;
+        case 'o': base = 8; break;
+        case 'b': base = 2; break;
+        default: return 0;
+        }
+        p++;
+        skip_spaces(&p, end);
+    } else {
+        if (size_end == s) return 0;
+        p = s;
+    }
+
+    uint64_t v = 0;
+    int digits = 0;
+    for (; p < end; p++) {
+        int c = (unsigned char)*p;
+        int d;
+        if (c == '_') continue;
+        if (isdigit(c)) d = c - '0';
+        else if (base == 16 && isxdigit(c)) d = (c | 0x20) - 'a' + 10;
+        else if ((c | 0x20) == 'x' || (c | 0x20) == 'z' || c == '?') d = 0;
+        else break;
+        if (d >= base) break;
+        v = base == 10 ? v * 10 + (uint64_t)d : (v << (base == 16 ? 4 : base == 8 ? 3 : 1)) | (uint64_t)d;
+        digits++;
+    }
+    if (!digits) return 0;
+    *out = v;
+    return 1;
+}
+
+static const char *parse_param_block(const char *p, const char *end, Lut *lut) {
+    // p points just past '#'. Parses "( .NAME(value), ... )", recording INIT
+    // into lut unless it is NULL.
+    // Returns the position after the closing ')', or NULL if malformed.
+    skip_spaces(&p, end);
+    if (p >= end || *p != '(') return NULL;
+    p++;
+    for (;;) {
+        skip_spaces(&p, end);
+        if (p >= end) return NULL;
+        if (*p == ')') return p + 1;
+        if (*p != '.') { p++; continue; } // ',' or a positional value
+
+        p++;
+        Token name;
+        if (!parse_identifier(&p, end, &name)) continue;
+        skip_spaces(&p, end);
+        if (p >= end || *p != '(') continue;
+        const char *v = ++p;
+        int depth = 1;
+        while (p < end) {
+            if (*p == '(') depth++;
+            else if (*p == ')' && --depth == 0) break;
+            else if (*p == '"') {
+                p++;
+                while (p < end && *p != '"') p += (*p == '\\' && p + 1 < end) ? 2 : 1;
+                if (p >= end) break;
+            }
+            p++;
+        }
+        if (p >= end) return NULL;
+        if (lut && name.len == 4 && memcmp(name.s, "INIT", 4) == 0) {
+            lut->has_init = (uint8_t)parse_verilog_int(v, p, &lut->init);
+        }
+        p++; // ')'
+    }
+}
+
+static const char *blank_comments(Arena *scratch, const char *s, const char *e) {
+    // Rare: a comment inside a port connection. Returns a scratch copy of
+    // [s, e) with comments replaced by spaces.
+    char *tmp = (char*)arena_alloc(scratch, (size_t)(e - s));
+    size_t k = 0;
+    const char *p = s;
+    while (p < e) {
+        if (*p == '/') {
+            const char *q = skip_comment(p, e);
+            if (q != p) {
+                while (p < q) { tmp[k++] = ' '; p++; }
+                continue;
+            }
+        }
+        tmp[k++] = *p++;
+    }
+    return tmp;
+}
+
+static uint32_t lut_add_net_span(Lut *l, NetTable *nets, Arena *scratch,
+                                 const char *s, const char *e, int has_comment) {
+    if (has_comment) {
+        const char *tmp = blank_comments(scratch, s, e);
+        e = tmp + (e - s);
+        s = tmp;
+    }
+    return lut_add_net_unique(l, nets, s, (size_t)(e - s));
+}
+
+// Pin-level view of a LUT, kept only for --prune-inputs: which net drives
+// each I<k> pin. Lut.in loses that (it is a sorted set), but the INIT table
+// is indexed by pin.
+typedef struct {
+    uint32_t net[LUT_MAX_INPUTS];  // NET_ID_PAD = unconnected
+    uint8_t width;                 // k of GTP_LUT<k>, or 0 if not prunable
+} LutPins;
+
+// --prune-inputs: a LUT only needs the inputs its function depends on. The
+// INIT table (bit k = output for pin pattern k, I0 = LSB) is widened to 64
+// bits, cofactored on pins tied to constants, and variable i is in the
+// support when the two cofactors differ: ((t >> 2^i) ^ t) & var_mask[i].
+// Lut.in is then rebuilt from the support pins, so more unions fit in six.
+static const uint64_t var_mask[LUT_MAX_INPUTS] = {
+    0x5555555555555555ull, 0x3333333333333333ull, 0x0F0F0F0F0F0F0F0Full,
+    0x00FF00FF00FF00FFull, 0x0000FFFF0000FFFFull, 0x00000000FFFFFFFFull,
+};
+
+static int net_is_const(const char *name, uint64_t *v) {
+    // Constant connections (1'b0, 1'b1, plain integers) are interned as nets.
+    return (isdigit((unsigned char)name[0]) || name[0] == '\'') &&
+           parse_verilog_int(name, name + strlen(name), v);
+}
+
+static void support_masks(const uint64_t *tt, uint8_t *supp, size_t n) {
+    // supp[k] bit i is set iff tt[k] depends on variable i. Straight-line
+    // over LUTs so the inner loops vectorize.
+    for (size_t k = 0; k < n; k++) supp[k] = 0;
+    for (int i = 0; i < LUT_MAX_INPUTS; i++) {
+        const uint64_t m = var_mask[i];
+        const int sh = 1 << i;
+        for (size_t k = 0; k < n; k++) supp[k] |= (uint8_t)(((((tt[k] >> sh) ^ tt[k]) & m) != 0) << i);
+    }
+}
+
+typedef struct {
+    int narrowed;       // LUTs that lost at least one input
+    int removed;        // inputs dropped in total
+    int const_pins;     // pins tied to a constant
+} PruneStats;
+
+static void prune_inputs(Lut *luts, const LutPins *pins, int n_luts, const NetTable *nets, PruneStats *st) {
+    memset(st, 0, sizeof(*st));
+    uint64_t *tt = (uint64_t*)xmalloc((size_t)n_luts * sizeof(uint64_t) + 1);
+    uint8_t *supp = (uint8_t*)xmalloc((size_t)n_luts + 1);
+    uint8_t *live = (uint8_t*)xmalloc((size_t)n_luts + 1);   // connected, non-constant pins
+
+    for (int k = 0; k < n_luts; k++) {
+        const LutPins *lp = &pins[k];
+        int w = lp->width;
+        uint64_t t = luts[k].init;
+        live[k] = 0;
+        if (!luts[k].has_init || w == 0) { tt[k] = 0; continue; }
+        if (w < LUT_MAX_INPUTS) t &= (1ull << (1u << w)) - 1;
+        for (int b = 1 << w; b < 64; b <<= 1) t |= t << b;
+        for (int i = 0; i < w; i++) {
+            uint32_t id = lp->net[i];
+            if (id == NET_ID_PAD) continue;
+            uint64_t v;
+            if (net_is_const(nets->bytes + nets->offs[id], &v)) {
+                // Restrict to the constant's cofactor, copied to both halves.
+                int sh = 1 << i;
+                uint64_t half = (v & 1) ? (t >> sh) & var_mask[i] : t & var_mask[i];
+                t = half | (half << sh);
+                st->const_pins++;
+                continue;
+            }
+            live[k] |= (uint8_t)(1u << i);
+        }
+        tt[k] = t;
+    }
+
+    support_masks(tt, supp, (size_t)n_luts);
+
+    for (int k = 0; k < n_luts; k++) {
+        Lut *l = &luts[k];
+        const LutPins *lp = &pins[k];
+        if (!l->has_init || lp->width == 0) continue;
+        uint8_t keep = supp[k] & live[k];
+        int old_n = l->n;
+        l->n = 0;
+        for (int i = 0; i < LUT_MAX_INPUTS; i++) l->in[i] = NET_ID_PAD;
+        for (int i = 0; i < lp->width; i++) {
+            if (!(keep & (1u << i))) continue;
+            uint32_t id = lp->net[i];
+            int dup = 0;
+            for (int q = 0; q < l->n; q++) dup |= (l->in[q] == id);
+            if (!dup) l->in[l->n++] = id;
+        }
+        lut_sort_inputs(l);
+        if (l->n < old_n) {
+            st->narrowed++;
+            st->removed += old_n - l->n;
+        }
+    }
+    free(tt);
+    free(supp);
+    free(live);
+}
+
+// Netlist connectivity (--graph): the drivers and sinks of every net over
+// all cells, not only LUTs. Cells 0..n_luts-1 are the LUTs in Netlist order;
+// the remaining cells follow in file order. Nets are interned in a table of
+// their own, so LUT input IDs (and every pairing result) are the same with
+// or without the graph. While parsing, connections are collected as
+// (net, cell, is_output) triples; net_graph_finish turns them into CSR.
+#define CELL_PENDING_OTHER 0x80000000u  // parse-time tag: index among non-LUT cells
+
+typedef struct {
+    NetTable nets;
+    uint32_t n_cells;
+    uint32_t n_luts;
+    uint32_t *drv_offs, *drv;     // net -> cells driving it
+    uint32_t *sink_offs, *sink;   // net -> cells reading it
+    uint32_t *out_offs, *out;     // cell -> nets it drives
+    uint32_t *in_offs, *in;       // cell -> nets it reads
+    uint32_t *pins;               // parse-time triples
+    size_t n_pins, cap_pins;
+    uint32_t n_other;             // non-LUT cells seen so far
+    uint8_t *other_comb;          // non-LUT cell -> combinational (parse time)
+    uint8_t *cell_comb;           // cell -> combinational, after net_graph_finish
+    NetTable buses;               // vector declarations seen so far
+    int32_t *bus_range;           // bus -> (hi, lo)
+    uint32_t bus_cap;
+} NetGraph;
+
+static int token_in(Token t, const char *const *list, size_t n) {
+    for (size_t k = 0; k < n; k++) {
+        if (strlen(list[k]) == t.len && memcmp(list[k], t.s, t.len) == 0) return 1;
+    }
+    return 0;
+}
+
+static int is_output_port(Token cell, Token port) {
+    // Output pins of the GTP primitives in the shipped netlists; anything
+    // else is treated as an input. Flip-flops use P as preset, and on the DSP
+    // block P is the product while Z is the adder input.
+    static const char *const outs[] = {
+        "Z", "Z5", "COUT", "Q", "O",
+        "DO", "DO1", "DO2", "DO3", "DOA", "DOB",
+    };
+    static const char *const apm_outs[] = { "P", "CPO", "CXO", "CXBO", "COUT" };
+    if (cell.len >= 7 && memcmp(cell.s, "GTP_APM", 7) == 0) {
+        return token_in(port, apm_outs, sizeof(apm_outs) / sizeof(apm_outs[0]));
+    }
+    return token_in(port, outs, sizeof(outs) / sizeof(outs[0]));
+}
+
+static void net_graph_add_pin(NetGraph *ng, const char *name, size_t len, uint32_t cell, int is_output) {
+    if (ng->n_pins + 3 > ng->cap_pins) {
+        ng->cap_pins = ng->cap_pins ? ng->cap_pins * 2 : 3 * 4096;
+        ng->pins = (uint32_t*)xrealloc(ng->pins, ng->cap_pins * sizeof(uint32_t));
+    }
+    ng->pins[ng->n_pins++] = net_intern(&ng->nets, name, len);
+    ng->pins[ng->n_pins++] = cell;
+    ng->pins[ng->n_pins++] = (uint32_t)is_output;
+}
+
+static void net_graph_add_bits(NetGraph *ng, const char *base, size_t base_len, long hi, long lo,
+                               uint32_t cell, int is_output) {
+    // One pin per bit of base[hi:lo], spelled "base[k]", or "base [k]" for an
+    // escaped identifier (its name ends at whitespace), so every way of
+    // naming a bit meets the same net.
+    char name[512];
+    int escaped = base[0] == '\\';
+    if (base_len + 24 > sizeof(name)) {
+        net_graph_add_pin(ng, base, base_len, cell, is_output);
+        return;
+    }
+    memcpy(name, base, base_len);
+    if (escaped) name[base_len] = ' ';
+    size_t pre = base_len + (size_t)escaped;
+    long step = hi >= lo ? -1 : 1;
+    for (long bit = hi;; bit += step) {
+        int n = snprintf(name + pre, sizeof(name) - pre, "[%ld]", bit);
+        net_graph_add_pin(ng, name, pre + (size_t)n, cell, is_output);
+        if (bit == lo) break;
+    }
+}
+
+static int parse_select(const char *p, const char *e, long *hi, long *lo) {
+    // p points at '['. Parses [k] or [hi:lo]; returns the length consumed, or 0.
+    const char *close = (const char*)memchr(p, ']', (size_t)(e - p));
+    if (!close) return 0;
+    char *next;
+    *hi = strtol(p + 1, &next, 10);
+    while (next < close && isspace((unsigned char)*next)) next++;
+    *lo = *hi;
+    if (next < close && *next == ':') *lo = strtol(next + 1, NULL, 10);
+    return (int)(close + 1 - p);
+}
+
+static void net_graph_add_expr(NetGraph *ng, const char *s, const char *e, uint32_t cell, int is_output) {
+    // A connection is a net, a bit or part select, a constant, or a { ... }
+    // concatenation of them; every named bit gets a pin, and a whole bus
+    // declared with a range expands to all of its bits. Constants (1'h0,
+    // 6'bxxxxx0) have none.
+    const char *p = s;
+    while (p < e) {
+        while (p < e && (isspace((unsigned char)*p) || *p == ',' || *p == '{' || *p == '}')) p++;
+        if (p >= e) break;
+        const char *t = p;
+        if (*p == '\\') {
+            while (p < e && !isspace((unsigned char)*p)) p++;
+        } else {
+            while (p < e && !isspace((unsigned char)*p) && *p != ',' && *p != '{' && *p != '}' && *p != '[') p++;
+        }
+        size_t base_len = (size_t)(p - t);
+        if (isdigit((unsigned char)*t) || *t == '\'') continue;
+
+        const char *q = p;
+        while (q < e && isspace((unsigned char)*q)) q++;
+        long hi, lo;
+        int used = (q < e && *q == '[') ? parse_select(q, e, &hi, &lo) : 0;
+        if (used) {
+            p = q + used;
+        } else {
+            uint32_t bus = net_lookup(&ng->buses, t, base_len);
+            if (bus == NET_ID_PAD) {
+                net_graph_add_pin(ng, t, base_len, cell, is_output);
+                continue;
+            }
+            hi = ng->bus_range[2 * bus];
+            lo = ng->bus_range[2 * bus + 1];
+        }
+        net_graph_add_bits(ng, t, base_len, hi, lo, cell, is_output);
+    }
+}
+
+static void net_graph_add_decl(NetGraph *ng, const char *p, const char *end) {
+    // p is just past wire/input/output/...: records the range of a vector
+    // declaration ("wire [15:0] a, b;") so whole-bus connections can expand.
+    skip_spaces(&p, end);
+    Token t;
+    if (parse_identifier(&p, end, &t) && !(t.len == 6 && memcmp(t.s, "signed", 6) == 0)) return;
+    skip_spaces(&p, end);
+    long hi, lo;
+    int used = (p < end && *p == '[') ? parse_select(p, end, &hi, &lo) : 0;
+    if (!used) return;
+    p += used;
+    for (;;) {
+        if (!parse_identifier(&p, end, &t)) return;
+        uint32_t id = net_intern(&ng->buses, t.s, t.len);
+        if (id >= ng->bus_cap) {
+            ng->bus_cap = ng->bus_cap ? ng->bus_cap * 2 : 256;
+            ng->bus_range = (int32_t*)xrealloc(ng->bus_range, (size_t)ng->bus_cap * 2 * sizeof(int32_t));
+        }
+        ng->bus_range[2 * id] = (int32_t)hi;
+        ng->bus_range[2 * id + 1] = (int32_t)lo;
+        skip_spaces(&p, end);
+        if (p >= end || *p != ',') return;
+        p++;
+    }
+}
+
+static void net_graph_init(NetGraph *ng) {
+    memset(ng, 0, sizeof(*ng));
+    net_table_init(&ng->nets);
+    net_table_init(&ng->buses);
+}
+
+static void net_graph_free(NetGraph *ng) {
+    net_table_free(&ng->nets);
+    net_table_free(&ng->buses);
+    free(ng->bus_range);
+    free(ng->drv_offs);
+    free(ng->drv);
+    free(ng->sink_offs);
+    free(ng->sink);
+    free(ng->out_offs);
+    free(ng->out);
+    free(ng->in_offs);
+    free(ng->in);
+    free(ng->pins);
+    free(ng->other_comb);
+    free(ng->cell_comb);
+    memset(ng, 0, sizeof(*ng));
+}
+
+// Where a LUT instance sits in the source text, kept only for --netlist:
+// the statement from its cell type through the ';', and the expression
+// connected to .Z. Pointers into the mapped source (Netlist.text).
+typedef struct {
+    const char *stmt, *stmt_end;
+    const char *z, *z_end;      // NULL when the instance has no .Z
+} LutSpan;
+
+// Parsed netlist: the LUT instances and the nets they reference. Instance
+// names live in `arena`, so freeing a netlist is a handful of free() calls
+// however many LUTs it holds.
+typedef struct {
+    Lut *luts;
+    int n_luts;
+    int cap_luts;
+    NetTable nets;
+    Arena arena;
+    NetGraph *graph;    // NULL unless connectivity is recorded (--graph)
+    LutPins *pins;      // parallel to luts when record_pins is set
+    int record_pins;
+    LutSpan *spans;     // parallel to luts when record_spans is set
+    int record_spans;
+    Source text;        // source kept mapped while spans point into it
+    Source cache;       // mapped .lutc; when set, `nets` points into it
+    const Source *drop; // --compact: mapping whose parsed pages are dropped, see drop_parsed
+    size_t dropped;     // bytes of `drop` released so far
+} Netlist;
+
+static void netlist_init(Netlist *nl) {
+    nl->luts = NULL;
+    nl->n_luts = 0;
+    nl->cap_luts = 0;
+    net_table_init(&nl->nets);
+    arena_init(&nl->arena);
+    nl->graph = NULL;
+    nl->pins = NULL;
+    nl->record_pins = 0;
+    nl->spans = NULL;
+    nl->record_spans = 0;
+    nl->text.data = NULL;
+    nl->cache.data = NULL;
+    nl->drop = NULL;
+    nl->dropped = 0;
+}
+
+static void netlist_free(Netlist *nl) {
+    free(nl->luts);
+    free(nl->pins);
+    free(nl->spans);
+    if (nl->text.data) source_close(&nl->text);
+    if (nl->cache.data) {
+        memset(&nl->nets, 0, sizeof(nl->nets));
+        source_close(&nl->cache);
+    } else {
+        net_table_free(&nl->nets);
+    }
+    arena_free(&nl->arena);
+    if (nl->graph) {
+        net_graph_free(nl->graph);
+        free(nl->graph);
+        nl->graph = NULL;
+    }
+    nl->luts = NULL;
+    nl->n_luts = nl->cap_luts = 0;
+}
+
+static int is_comb_cell(Token cell) {
+    // Combinational primitives other than the pairable LUTs: carry LUTs and
+    // inverters. Flip-flops, RAM, DSP and I/O buffers bound logic levels.
+    return (cell.len >= 7 && memcmp(cell.s, "GTP_LUT", 7) == 0) ||
+           (cell.len == 7 && memcmp(cell.s, "GTP_INV", 7) == 0);
+}
+
+static int is_statement_keyword(Token t) {
+    // Module-level statements that start with a keyword rather than a cell type.
+    static const char *const kw[] = {
+        "module", "macromodule", "input", "output", "inout", "wire", "tri", "reg",
+        "supply0", "supply1", "assign", "parameter", "localparam", "defparam",
+    };
+    return token_in(t, kw, sizeof(kw) / sizeof(kw[0]));
+}
+
+// --compact on a mapped file: every COMPACT_WINDOW bytes the parser drops
+// the pages it has finished, so the file is never resident as a whole. The
+// mapping is read-only, so a dropped page that is touched again (--netlist
+// splices from it) is simply read back in.
+#ifndef COMPACT_WINDOW
+#define COMPACT_WINDOW (4u << 20)
+#endif
+
+static void drop_parsed(Netlist *nl, const char *p) {
+    // nl->dropped stays page-aligned: it is where the next madvise starts.
+    size_t upto = (size_t)(p - nl->drop->data);
+#ifdef MADV_DONTNEED
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    upto = upto / page * page;
+    if (upto > nl->dropped) madvise((void*)(nl->drop->data + nl->dropped), upto - nl->dropped, MADV_DONTNEED);
+#endif
+    nl->dropped = upto;
+}
+
+static void parse_luts_span(const char *p, const char *end, Netlist *nl) {
+    // Single pass over a read-only span, one statement at a time. Only LUT
+    // instances are tokenized:
+    //   GTP_LUT<n> [#( .INIT(<literal>) ... )] <inst> ( .I0(net) ... );
+    // every other statement is skipped up to its ';' with find_any4. With a
+    // NetGraph, every other cell instance is tokenized as well and all
+    // connections, LUT outputs included, are recorded as pins.
+    NetGraph *ng = nl->graph;
+    STAT_ADD(parse_bytes, end - p);
+    while (p < end) {
+        if (nl->drop && (size_t)(p - nl->drop->data) - nl->dropped >= COMPACT_WINDOW) drop_parsed(nl, p);
+        skip_spaces(&p, end);
+        if (p >= end) break;
+        if (*p == '`') { // compiler directive: runs to end of line
+            const char *nl_pos = (const char*)memchr(p, '\n', (size_t)(end - p));
+            p = nl_pos ? nl_pos : end;
+            continue;
+        }
+        if (p[0] == '(' && end - p >= 2 && p[1] == '*') { // (* attribute *)
+            p += 2;
+            while (end - p >= 2 && !(p[0] == '*' && p[1] == ')')) p++;
+            p = end - p >= 2 ? p + 2 : end;
+            continue;
+        }
+
+        Token cell, inst, port;
+        const char *stmt = p;
+        if (!parse_identifier(&p, end, &cell)) { p = skip_statement(p, end); continue; }
+        int is_lut = is_gtp_lut_cell(cell);
+        if (!is_lut) {
+            // endmodule is the one netlist statement without a ';'
+            if (cell.len == 9 && memcmp(cell.s, "endmodule", 9) == 0) continue;
+            if (!ng || is_statement_keyword(cell)) {
+                static const char *const decl[] = { "input", "output", "inout", "wire", "tri", "reg" };
+                if (ng && token_in(cell, decl, sizeof(decl) / sizeof(decl[0]))) net_graph_add_decl(ng, p, end);
+                p = skip_statement(p, end);
+                continue;
+            }
+        }
+
+        Lut lut = {0};
+        LutSpan span = { stmt, NULL, NULL, NULL };
+        LutPins pins;
+        for (int k = 0; k < LUT_MAX_INPUTS; k++) lut.in[k] = pins.net[k] = NET_ID_PAD;
+        pins.width = 0;
+        if (is_lut && cell.len == 8) pins.width = (uint8_t)(cell.s[7] - '0');
+        if (pins.width > LUT_MAX_INPUTS) pins.width = 0;
+
+        // optional parameter block
+        skip_spaces(&p, end);
+        if (p < end && *p == '#') {
+            const char *q = parse_param_block(p + 1, end, is_lut ? &lut : NULL);
+            if (!q) { p = skip_statement(p, end); continue; }
+            p = q;
+        }
+
+        // instance name
+        if (!parse_identifier(&p, end, &inst)) { p = skip_statement(p, end); continue; }
+
+        skip_spaces(&p, end);
+        if (p >= end || *p != '(') { p = skip_statement(p, end); continue; }
+
+        // parse port connections until matching ")" then ";"
+        p++; // consume '('
+        uint32_t cell_id = 0;
+        if (is_lut) {
+            lut.inst = arena_strndup(&nl->arena, inst.s, inst.len);
+            cell_id = (uint32_t)nl->n_luts;
+        } else {
+            cell_id = CELL_PENDING_OTHER | ng->n_other;
+        }
+
+        int depth = 1;
+        while (p < end && depth > 0) {
+            // expecting .PortName(net)
+            p = find_any4(p, end, '.', '(', ')', '/');
+            if (p >= end) break;
+            if (*p == '/') {
+                const char *q = skip_comment(p, end);
+                p = q != p ? q : p + 1;
+                continue;
+            }
+            if (*p == ')') { depth--; p++; break; }
+            if (*p == '(') { depth++; p++; continue; }
+
+            p++; // '.'
+            // port identifier
+            if (!parse_identifier(&p, end, &port)) continue;
+            skip_spaces(&p, end);
+            if (p >= end || *p != '(') continue;
+            p++; // '('
+
+            // capture net expression until ')'
+            const char *net_start = p;
+            int has_comment = 0;
+            p = scan_net_end(p, end, &has_comment);
+            const char *net_end = p;
+            if (p < end) p++;
+
+            if (ng) {
+                const char *s = net_start, *e = net_end;
+                if (has_comment) {
+                    s = blank_comments(&nl->arena, net_start, net_end);
+                    e = s + (net_end - net_start);
+                }
+                net_graph_add_expr(ng, s, e, cell_id, is_output_port(cell, port));
+            }
+            if (!is_lut) continue;
+            if (port.len == 1 && port.s[0] == 'Z') {
+                span.z = net_start;
+                span.z_end = net_end;
+            }
+
+            // Decide whether to record
+            // Only .I<number>(net)
+            int record = 0;
+            if (port.s[0] == 'I' && port.len > 1) { // must have digits
+                record = 1;
+                for (size_t i = 1; i < port.len; i++) {
+                    if (!isdigit((unsigned char)port.s[i])) { record = 0; break; }
+                }
+            }
+            if (!record) continue;
+            uint32_t id = lut_add_net_span(&lut, &nl->nets, &nl->arena, net_start, net_end, has_comment);
+            long pin = strtol(port.s + 1, NULL, 10);
+            if (pin < pins.width) pins.net[pin] = id;
+            else pins.width = 0;
+        }
+
+        // advance to semicolon if present
+        while (p < end && *p != ';' && *p != '\n') p++;
+        if (p < end && *p == ';') p++;
+
+        if (!is_lut) {
+            if ((ng->n_other & (ng->n_other - 1)) == 0) { // grows at powers of two
+                ng->other_comb = (uint8_t*)xrealloc(ng->other_comb, (size_t)ng->n_other * 2 + 1);
+            }
+            ng->other_comb[ng->n_other++] = (uint8_t)is_comb_cell(cell);
+            continue;
+        }
+        lut_sort_inputs(&lut);
+
+        // store lut
+        if (nl->n_luts == nl->cap_luts) {
+            nl->cap_luts = nl->cap_luts ? nl->cap_luts * 2 : 64;
+            nl->luts = (Lut*)xrealloc(nl->luts, (size_t)nl->cap_luts * sizeof(Lut));
+            if (nl->record_pins) nl->pins = (LutPins*)xrealloc(nl->pins, (size_t)nl->cap_luts * sizeof(LutPins));
+            if (nl->record_spans) nl->spans = (LutSpan*)xrealloc(nl->spans, (size_t)nl->cap_luts * sizeof(LutSpan));
+        }
+        if (nl->record_spans) {
+            span.stmt_end = p;
+            nl->spans[nl->n_luts] = span;
+        }
+        if (nl->record_pins) {
+            if (lut.n == LUT_TOO_WIDE) pins.width = 0;
+            nl->pins[nl->n_luts] = pins;
+        }
+        nl->luts[nl->n_luts++] = lut;
+    }
+}
+
+static int parse_luts_from_buffer(const char *buf, size_t buf_len, Netlist *nl) {
+    parse_luts_span(buf, buf + buf_len, nl);
+    return 1;
+}
+
+// Streaming mode: the input is read through a fixed-size buffer and only
+// complete statements (up to a top-level ';') are handed to parse_luts_span,
+// so tokens, escaped identifiers and port lists that straddle a read boundary
+// are simply carried over to the next fill. Memory stays at STREAM_BUF_SIZE
+// regardless of the netlist size, and the input may be a pipe.
+#ifndef STREAM_BUF_SIZE
+#define STREAM_BUF_SIZE (1u << 20)
+#endif
+
+typedef struct {
+    int line_comment;
+    int block_comment;
+    int escaped;        // inside \escaped_identifier (ends at whitespace)
+    int string;         // inside "..."
+    int string_escape;  // previous char in string was a backslash
+    int prev;           // previous byte, for two-character comment delimiters
+} SplitState;
+
+static size_t split_scan(SplitState *st, const char *buf, size_t from, size_t to, size_t *last_stmt_end) {
+    // Advances the lexer state over buf[from, to). Every top-level ';' moves
+    // *last_stmt_end just past it. Returns to.
+    for (size_t i = from; i < to; i++) {
+        int c = (unsigned char)buf[i];
+        int prev = st->prev;
+        st->prev = c;
+        if (st->line_comment) {
+            if (c == '\n') st->line_comment = 0;
+            continue;
+        }
+        if (st->block_comment) {
+            if (prev == '*' && c == '/') { st->block_comment = 0; st->prev = 0; }
+            continue;
+        }
+        if (st->escaped) {
+            if (isspace(c)) st->escaped = 0;
+            continue;
+        }
+        if (st->string) {
+            if (st->string_escape) st->string_escape = 0;
+            else if (c == '\\') st->string_escape = 1;
+            else if (c == '"') st->string = 0;
+            continue;
+        }
+        if (prev == '/' && c == '/') { st->line_comment = 1; continue; }
+        if (prev == '/' && c == '*') { st->block_comment = 1; st->prev = 0; continue; }
+        if (c == '\\') st->escaped = 1;
+        else if (c == '"') st->string = 1;
+        else if (c == ';') *last_stmt_end = i + 1;
+    }
+    return to;
+}
+
+static int span_starts_with_lut(const char *p, const char *end) {
+    Token cell;
+    return parse_identifier(&p, end, &cell) && is_gtp_lut_cell(cell);
+}
+
+static int parse_luts_from_stream(FILE *in, const char *name, Netlist *nl) {
+    char *buf = (char*)xmalloc(STREAM_BUF_SIZE);
+    SplitState st = {0};
+    size_t fill = 0;     // valid bytes in buf
+    size_t scanned = 0;  // bytes already fed to split_scan
+    int skipping = 0;    // discarding an oversized non-LUT statement
+    int ok = 1;
+
+    for (;;) {
+        size_t rd = fread(buf + fill, 1, STREAM_BUF_SIZE - fill, in);
+        fill += rd;
+        int eof = (rd == 0);
+
+        size_t stmt_end = 0;
+        scanned = split_scan(&st, buf, scanned, fill, &stmt_end);
+        if (stmt_end) {
+            if (!skipping) parse_luts_span(buf, buf + stmt_end, nl);
+            skipping = 0;
+            memmove(buf, buf + stmt_end, fill - stmt_end);
+            fill -= stmt_end;
+            scanned -= stmt_end;
+        }
+
+        if (eof) {
+            if (!skipping && fill) parse_luts_span(buf, buf + fill, nl);
+            if (ferror(in)) {
+                fprintf(stderr, "Read error on %s\n", name);
+                ok = 0;
+            }
+            break;
+        }
+
+        if (fill == STREAM_BUF_SIZE) {
+            // One statement fills the whole buffer. LUT instances are small,
+            // so this is a module header or a wide bus cell: drop it.
+            if (!skipping && span_starts_with_lut(buf, buf + fill)) {
+                fprintf(stderr, "%s: LUT statement exceeds %u-byte stream buffer\n",
+                        name, STREAM_BUF_SIZE);
+                ok = 0;
+                break;
+            }
+            skipping = 1;
+            fill = 0;
+            scanned = 0;
+        }
+    }
+
+    free(buf);
+    return ok;
+}
+
+// Binary netlist cache (--cache). design_x_syn.v gets a sidecar
+// design_x_syn.lutc holding everything pairing needs: the LUT records, the
+// instance names and the whole net intern table, slots included. A later
+// run checks the source size and content hash against the header and maps
+// the file: LUT records are copied into a fresh array (pairing writes to
+// them), while the net table points straight into the mapping, which the
+// netlist keeps until netlist_free. Native byte order; a sidecar written on
+// a machine with another layout fails the header check and is rewritten.
+#define LUTC_MAGIC   "LUTPAIRC"
+#define LUTC_VERSION 1u
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t lut_size;      // sizeof(LutcRecord), guards against layout changes
+    uint64_t src_size;
+    uint64_t src_hash;
+    uint32_t n_luts;
+    uint32_t n_nets;
+    uint32_t net_mask;
+    uint32_t pad;
+    uint64_t names_len;     // instance name bytes, NUL-terminated back to back
+    uint64_t net_bytes_len;
+} LutcHeader;
+
+typedef struct {
+    uint64_t init;
+    uint32_t in[LUT_MAX_INPUTS];
+    uint32_t name_off;
+    uint8_t n;
+    uint8_t has_init;
+    uint8_t pad[2];
+} LutcRecord;
+
+static uint64_t hash_source(const char *p, size_t len) {
+    // 8 bytes per step (multiply, xor-shift); only has to notice edits.
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    for (; i < len; i++) h = (h ^ (unsigned char)p[i]) * 0x100000001B3ull;
+    return h ^ (h >> 29);
+}
+
+static size_t lutc_align(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static void cache_path_for(const char *infile, char *out, size_t cap) {
+    size_t len = strlen(infile);
+    if (len >= 2 && strcmp(infile + len - 2, ".v") == 0) len -= 2;
+    snprintf(out, cap, "%.*s.lutc", (int)len, infile);
+}
+
+static int cache_body_valid(const LutcHeader *h, const LutcRecord *rec, const char *names,
+                            const uint32_t *offs, const uint32_t *slots, const char *bytes) {
+    // The header only vouches for the source; a damaged body whose header
+    // still matches must not send the fanout index or the writer out of
+    // bounds. One pass over the records and the net table.
+    if (h->n_luts && (h->names_len == 0 || names[h->names_len - 1] != '\0')) return 0;
+    if (h->n_nets && (h->net_bytes_len == 0 || bytes[h->net_bytes_len - 1] != '\0')) return 0;
+    for (uint32_t k = 0; k < h->n_luts; k++) {
+        const LutcRecord *r = &rec[k];
+        if (r->n > LUT_TOO_WIDE || r->name_off >= h->names_len) return 0;
+        for (int q = 0; q < LUT_MAX_INPUTS; q++) {
+            uint32_t id = r->in[q];
+            int live = q < r->n && r->n <= LUT_MAX_INPUTS;
+            if (id >= h->n_nets && (live || id != NET_ID_PAD)) return 0;
+        }
+    }
+    for (uint32_t id = 0; id < h->n_nets; id++) {
+        if (offs[id] >= h->net_bytes_len) return 0;
+    }
+    size_t empty = 0;
+    for (size_t k = 0; k <= h->net_mask; k++) {
+        if (slots[k] > h->n_nets) return 0;
+        empty += slots[k] == 0;
+    }
+    return empty > 0; // probing stops at an empty slot
+}
+
+static int cache_load(const char *path, uint64_t src_size, uint64_t src_hash, Netlist *nl) {
+    // Returns 1 and fills nl (which must be empty) on a valid cache.
+    Source c;
+    if (!source_open(&c, path)) return 0;
+    LutcHeader h;
+    if (c.len < sizeof(h)) { source_close(&c); return 0; }
+    memcpy(&h, c.data, sizeof(h));
+    size_t off_recs = lutc_align(sizeof(h));
+    size_t off_names = off_recs + lutc_align((size_t)h.n_luts * sizeof(LutcRecord));
+    size_t off_offs = off_names + lutc_align(h.names_len);
+    size_t off_hash = off_offs + lutc_align((size_t)h.n_nets * sizeof(uint32_t));
+    size_t off_slots = off_hash + lutc_align((size_t)h.n_nets * sizeof(uint32_t));
+    size_t off_bytes = off_slots + lutc_align(((size_t)h.net_mask + 1) * sizeof(uint32_t));
+    if (memcmp(h.magic, LUTC_MAGIC, 8) != 0 || h.version != LUTC_VERSION ||
+        h.lut_size != sizeof(LutcRecord) || h.src_size != src_size || h.src_hash != src_hash ||
+        ((h.net_mask + 1) & h.net_mask) != 0 || h.names_len > c.len || h.net_bytes_len > c.len ||
+        off_bytes + h.net_bytes_len > c.len) {
+        source_close(&c);
+        return 0;
+    }
+
+    const LutcRecord *rec = (const LutcRecord*)(c.data + off_recs);
+    const char *names = c.data + off_names;
+    if (!cache_body_valid(&h, rec, names, (const uint32_t*)(c.data + off_offs),
+                          (const uint32_t*)(c.data + off_slots), c.data + off_bytes)) {
+        source_close(&c);
+        return 0;
+    }
+    net_table_free(&nl->nets);
+    nl->luts = (Lut*)xmalloc((size_t)h.n_luts * sizeof(Lut) + 1);
+    nl->n_luts = nl->cap_luts = (int)h.n_luts;
+    for (uint32_t k = 0; k < h.n_luts; k++) {
+        Lut *l = &nl->luts[k];
+        memset(l, 0, sizeof(*l));
+        l->inst = (char*)names + rec[k].name_off;
+        memcpy(l->in, rec[k].in, sizeof(l->in));
+        l->init = rec[k].init;
+        l->n = rec[k].n;
+        l->has_init = rec[k].has_init;
+    }
+    NetTable *t = &nl->nets;
+    t->bytes = (char*)(c.data + off_bytes);
+    t->bytes_len = t->bytes_cap = h.net_bytes_len;
+    t->offs = (uint32_t*)(c.data + off_offs);
+    t->hash = (uint32_t*)(c.data + off_hash);
+    t->count = t->cap = h.n_nets;
+    t->slots = (uint32_t*)(c.data + off_slots);
+    t->mask = h.net_mask;
+    nl->cache = c;
+    return 1;
+}
+
+static int cache_store(const char *path, uint64_t src_size, uint64_t src_hash, const Netlist *nl) {
+    // Written to a temporary and renamed, so readers never see a partial file.
+    char tmp[1100];
+    temp_path_for(path, tmp, sizeof(tmp));
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return 0;
+
+    LutcHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, LUTC_MAGIC, 8);
+    h.version = LUTC_VERSION;
+    h.lut_size = sizeof(LutcRecord);
+    h.src_size = src_size;
+    h.src_hash = src_hash;
+    h.n_luts = (uint32_t)nl->n_luts;
+    h.n_nets = nl->nets.count;
+    h.net_mask = nl->nets.mask;
+    h.net_bytes_len = nl->nets.bytes_len;
+    LutcRecord *rec = (LutcRecord*)xmalloc((size_t)nl->n_luts * sizeof(LutcRecord) + 1);
+    for (int k = 0; k < nl->n_luts; k++) {
+        const Lut *l = &nl->luts[k];
+        memset(&rec[k], 0, sizeof(rec[k]));
+        memcpy(rec[k].in, l->in, sizeof(rec[k].in));
+        rec[k].init = l->init;
+        rec[k].n = l->n;
+        rec[k].has_init = l->has_init;
+        rec[k].name_off = (uint32_t)h.names_len;
+        h.names_len += strlen(l->inst) + 1;
+    }
+
+    static const char zeros[8] = {0};
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    ok &= fwrite(zeros, 1, lutc_align(sizeof(h)) - sizeof(h), f) == lutc_align(sizeof(h)) - sizeof(h);
+    size_t recs_len = (size_t)nl->n_luts * sizeof(LutcRecord);
+    ok &= fwrite(rec, 1, recs_len, f) == recs_len;
+    ok &= fwrite(zeros, 1, lutc_align(recs_len) - recs_len, f) == lutc_align(recs_len) - recs_len;
+    for (int k = 0; k < nl->n_luts; k++) {
+        const char *name = nl->luts[k].inst;
+        ok &= fputs(name, f) >= 0 && fputc('\0', f) != EOF;
+    }
+    ok &= fwrite(zeros, 1, lutc_align(h.names_len) - h.names_len, f) == lutc_align(h.names_len) - h.names_len;
+    const void *parts[3] = { nl->nets.offs, nl->nets.hash, nl->nets.slots };
+    size_t lens[3] = { (size_t)h.n_nets * sizeof(uint32_t), (size_t)h.n_nets * sizeof(uint32_t),
+                       ((size_t)h.net_mask + 1) * sizeof(uint32_t) };
+    for (int k = 0; k < 3; k++) {
+        if (lens[k]) ok &= fwrite(parts[k], 1, lens[k], f) == lens[k];
+        ok &= fwrite(zeros, 1, lutc_align(lens[k]) - lens[k], f) == lutc_align(lens[k]) - lens[k];
+    }
+    if (h.net_bytes_len) ok &= fwrite(nl->nets.bytes, 1, h.net_bytes_len, f) == h.net_bytes_len;
+    free(rec);
+    ok &= fclose(f) == 0;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+// Compatibility test: can a and b share one LUT6D, i.e. is the union of
+// their input sets at most six nets? Both `in` arrays are sorted and padded
+// with NET_ID_PAD. The kernels are only called once both LUTs are known to be
+// narrow enough and na + nb > 6 (see union_unique_count_le6).
+
+static int union_fits_scalar(const uint32_t *a, int na, const uint32_t *b, int nb) {
+    // Merge walk over the two sorted arrays; u counts union elements seen so
+    // far and the walk stops as soon as it passes six.
+    int i = 0, j = 0, u = 0;
+    while (i < na && j < nb) {
+        uint32_t x = a[i], y = b[j];
+        i += (x <= y);
+        j += (y <= x);
+        if (++u > LUT_MAX_INPUTS) return 0;
+    }
+    return u + (na - i) + (nb - j) <= LUT_MAX_INPUTS;
+}
+
+#ifdef LUTPAIR_X86_DISPATCH
+__attribute__((target("sse4.1")))
+static int union_fits_sse41(const uint32_t *a, int na, const uint32_t *b, int nb) {
+    // a in two 4-lane registers (lanes 6 and 7 forced to the pad value),
+    // each b[j] broadcast and compared against all six lanes at once.
+    __m128i lo = _mm_loadu_si128((const __m128i*)a);
+    __m128i hi = _mm_loadl_epi64((const __m128i*)(a + 4));
+    hi = _mm_blend_epi16(hi, _mm_set1_epi32((int)NET_ID_PAD), 0xF0);
+    int common = 0;
+    for (int j = 0; j < nb; j++) {
+        __m128i v = _mm_set1_epi32((int)b[j]);
+        __m128i eq = _mm_or_si128(_mm_cmpeq_epi32(lo, v), _mm_cmpeq_epi32(hi, v));
+        common += !_mm_testz_si128(eq, eq);
+    }
+    return na + nb - common <= LUT_MAX_INPUTS;
+}
+
+__attribute__((target("avx2")))
+static int union_fits_avx2(const uint32_t *a, int na, const uint32_t *b, int nb) {
+    // a in one 8-lane register; six broadcasts of b, no data-dependent branches.
+    __m128i lo = _mm_loadu_si128((const __m128i*)a);
+    __m128i hi = _mm_loadl_epi64((const __m128i*)(a + 4));
+    hi = _mm_blend_epi32(hi, _mm_set1_epi32((int)NET_ID_PAD), 0xC);
+    __m256i va = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    __m256i acc = _mm256_setzero_si256();
+    for (int j = 0; j < LUT_MAX_INPUTS; j++) {
+        __m256i v = _mm256_set1_epi32((int)b[j]);
+        acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(va, v));
+    }
+    // Only lanes holding one of a's real IDs count; the rest are pad == pad.
+    __m256i keep = _mm256_cmpgt_epi32(_mm256_set1_epi32(na),
+                                      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    acc = _mm256_and_si256(acc, keep);
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return na + nb - _mm_cvtsi128_si32(s) <= LUT_MAX_INPUTS;
+}
+#endif
+
+typedef int (*UnionFitsFn)(const uint32_t *a, int na, const uint32_t *b, int nb);
+
+// Chosen once (lutpair_select_kernel) before any testcase runs.
+static UnionFitsFn union_fits = union_fits_scalar;
+
+const char *lutpair_select_kernel(const char *want) {
+    // want: NULL/"auto" picks the best the CPU supports.
+    int is_auto = !want || strcmp(want, "auto") == 0;
+#ifdef LUTPAIR_X86_DISPATCH
+    __builtin_cpu_init();
+    if ((is_auto || strcmp(want, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        union_fits = union_fits_avx2;
+        return "avx2";
+    }
+    if ((is_auto || strcmp(want, "sse4.1") == 0) && __builtin_cpu_supports("sse4.1")) {
+        union_fits = union_fits_sse41;
+        return "sse4.1";
+    }
+#endif
+    if (!is_auto && strcmp(want, "scalar") != 0) return NULL;
+    union_fits = union_fits_scalar;
+    return "scalar";
+}
+
+// --preserve-depth: two LUTs may only share a LUT6D when their logic levels
+// differ by at most 1 plus the smaller of their slacks, so critical LUTs stay
+// with same- or adjacent-level partners and only LUTs off the critical path
+// may pair across more levels. levelize marks the LUTs of the design it ran
+// on (Lut.leveled), so the gate goes with the records rather than the
+// process.
+
+#define DEPTH_SCAN_LIMIT 64  // depth-incompatible LUTs looked past per size bucket
+
+static inline int depth_compatible(const Lut *a, const Lut *b) {
+    int d = (int)a->level - (int)b->level;
+    int slack = a->slack < b->slack ? a->slack : b->slack;
+    return (d < 0 ? -d : d) <= 1 + slack;
+}
+
+// Input signatures: bit hash(id) % 64 is set for each input ID. Distinct IDs
+// may share a bit, so popcount(a.sig | b.sig) never exceeds the size of the
+// union: more than six bits rejects the pair without looking at the IDs.
+// Run lut_signatures once the input sets are final (after pruning).
+static inline uint64_t lut_signature(const Lut *l) {
+    uint64_t sig = 0;
+    for (int k = 0; k < l->n && k < LUT_MAX_INPUTS; k++) {
+        sig |= 1ull << ((l->in[k] * 0x9E3779B97F4A7C15ull) >> 58);
+    }
+    return sig;
+}
+
+static void lut_signatures(Lut *luts, int n_luts) {
+    for (int k = 0; k < n_luts; k++) luts[k].sig = lut_signature(&luts[k]);
+}
+
+static inline int popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (int)((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+static inline int union_unique_count_le6(const Lut *a, const Lut *b) {
+    int na = a->n, nb = b->n;
+    STAT_ADD(union_calls, 1);
+    if (na > LUT_MAX_INPUTS || nb > LUT_MAX_INPUTS) { STAT_ADD(union_rejects, 1); return 0; }
+    if (a->leveled && !depth_compatible(a, b)) { STAT_ADD(union_rejects, 1); return 0; }
+    if (na + nb <= LUT_MAX_INPUTS) { STAT_ADD(union_fast, 1); return 1; }
+    if (popcount64(a->sig | b->sig) > LUT_MAX_INPUTS) {
+        STAT_ADD(sig_rejects, 1);
+        STAT_ADD(union_rejects, 1);
+        return 0;
+    }
+#ifdef LUTPAIR_STATS
+    int fits = union_fits(a->in, na, b->in, nb);
+    if (!fits) STAT_ADD(union_rejects, 1);
+    return fits;
+#else
+    return union_fits(a->in, na, b->in, nb);
+#endif
+}
+
+// Net -> LUT fanout index in CSR form: the LUTs reading net `id` are
+// luts[offs[id] .. offs[id + 1]), in ascending LUT order.
+typedef struct {
+    uint32_t *offs;
+    uint32_t *luts;
+    uint32_t n_nets;
+} FanoutIndex;
+
+static void build_fanout_index_of(const Lut *luts, int n_luts, uint32_t n_nets, FanoutIndex *fx) {
+    fx->n_nets = n_nets;
+    fx->offs = (uint32_t*)calloc((size_t)n_nets + 1, sizeof(uint32_t));
+    if (!fx->offs) { fprintf(stderr, "OOM\n"); exit(1); }
+
+    for (int i = 0; i < n_luts; i++) {
+        const Lut *l = &luts[i];
+        if (l->n > LUT_MAX_INPUTS) continue;
+        for (int k = 0; k < l->n; k++) fx->offs[l->in[k] + 1]++;
+    }
+    for (uint32_t id = 0; id < n_nets; id++) fx->offs[id + 1] += fx->offs[id];
+
+    fx->luts = (uint32_t*)xmalloc((size_t)fx->offs[n_nets] * sizeof(uint32_t) + 1);
+    uint32_t *fill = (uint32_t*)xmalloc(((size_t)n_nets + 1) * sizeof(uint32_t));
+    memcpy(fill, fx->offs, (size_t)n_nets * sizeof(uint32_t));
+    for (int i = 0; i < n_luts; i++) {
+        const Lut *l = &luts[i];
+        if (l->n > LUT_MAX_INPUTS) continue;
+        for (int k = 0; k < l->n; k++) fx->luts[fill[l->in[k]]++] = (uint32_t)i;
+    }
+    free(fill);
+}
+
+static void build_fanout_index(const Netlist *nl, FanoutIndex *fx) {
+    build_fanout_index_of(nl->luts, nl->n_luts, nl->nets.count, fx);
+}
+
+static void free_fanout_index(FanoutIndex *fx) {
+    free(fx->offs);
+    free(fx->luts);
+    fx->offs = fx->luts = NULL;
+}
+
+// LUT IDs grouped by input count: the LUTs with exactly s inputs are
+// ids[start[s] .. start[s + 1]), ascending. Too-wide LUTs are left out.
+typedef struct {
+    uint32_t *ids;
+    uint32_t start[LUT_MAX_INPUTS + 2];
+} SizeBuckets;
+
+static void build_size_buckets(const Lut *luts, int n_luts, SizeBuckets *sb) {
+    uint32_t count[LUT_MAX_INPUTS + 1] = {0};
+    for (int i = 0; i < n_luts; i++) {
+        if (luts[i].n <= LUT_MAX_INPUTS) count[luts[i].n]++;
+    }
+    sb->start[0] = 0;
+    for (int s = 0; s <= LUT_MAX_INPUTS; s++) sb->start[s + 1] = sb->start[s] + count[s];
+    sb->ids = (uint32_t*)xmalloc((size_t)sb->start[LUT_MAX_INPUTS + 1] * sizeof(uint32_t) + 1);
+    uint32_t fill[LUT_MAX_INPUTS + 1];
+    memcpy(fill, sb->start, sizeof(fill));
+    for (int i = 0; i < n_luts; i++) {
+        if (luts[i].n <= LUT_MAX_INPUTS) sb->ids[fill[luts[i].n]++] = (uint32_t)i;
+    }
+}
+
+static void free_size_buckets(SizeBuckets *sb) {
+    free(sb->ids);
+    sb->ids = NULL;
+}
+
+// Structure-of-arrays copy of the fields pair_first_fit reads: 24-byte
+// input rows, counts, signatures and a used bitset (levels only with
+// --preserve-depth), so the candidate loop streams through a few dense
+// arrays instead of 56-byte Lut records whose name and INIT it never needs.
+typedef struct {
+    uint32_t (*in)[LUT_MAX_INPUTS];
+    uint8_t *n;
+    uint64_t *sig;
+    uint16_t *level, *slack;
+    uint64_t *used;
+} LutSoA;
+
+static void lut_soa_build(const Lut *luts, int n_luts, LutSoA *s) {
+    size_t n = (size_t)n_luts;
+    s->in = (uint32_t (*)[LUT_MAX_INPUTS])xmalloc(n * sizeof(*s->in) + 1);
+    s->n = (uint8_t*)xmalloc(n + 1);
+    s->sig = (uint64_t*)xmalloc(n * sizeof(uint64_t) + 1);
+    s->used = (uint64_t*)calloc(n / 64 + 1, sizeof(uint64_t));
+    if (!s->used) { fprintf(stderr, "OOM\n"); exit(1); }
+    s->level = s->slack = NULL;
+    int leveled = n_luts > 0 && luts[0].leveled;
+    if (leveled) {
+        s->level = (uint16_t*)xmalloc(n * sizeof(uint16_t) + 1);
+        s->slack = (uint16_t*)xmalloc(n * sizeof(uint16_t) + 1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        memcpy(s->in[i], luts[i].in, sizeof(s->in[i]));
+        s->n[i] = luts[i].n;
+        s->sig[i] = luts[i].sig;
+        if (luts[i].used) s->used[i / 64] |= 1ull << (i % 64);
+        if (leveled) {
+            s->level[i] = luts[i].level;
+            s->slack[i] = luts[i].slack;
+        }
+    }
+}
+
+static void lut_soa_free(LutSoA *s) {
+    free(s->in);
+    free(s->n);
+    free(s->sig);
+    free(s->used);
+    free(s->level);
+    free(s->slack);
+}
+
+static inline int soa_used(const LutSoA *s, uint32_t i) {
+    return (int)((s->used[i / 64] >> (i % 64)) & 1);
+}
+
+static inline int soa_depth_compatible(const LutSoA *s, uint32_t i, uint32_t j) {
+    int d = (int)s->level[i] - (int)s->level[j];
+    int slack = s->slack[i] < s->slack[j] ? s->slack[i] : s->slack[j];
+    return (d < 0 ? -d : d) <= 1 + slack;
+}
+
+static inline int soa_fits(const LutSoA *s, uint32_t i, uint32_t j) {
+    // union_unique_count_le6 on the SoA view.
+    int na = s->n[i], nb = s->n[j];
+    STAT_ADD(union_calls, 1);
+    if (na > LUT_MAX_INPUTS || nb > LUT_MAX_INPUTS) { STAT_ADD(union_rejects, 1); return 0; }
+    if (s->level && !soa_depth_compatible(s, i, j)) { STAT_ADD(union_rejects, 1); return 0; }
+    if (na + nb <= LUT_MAX_INPUTS) { STAT_ADD(union_fast, 1); return 1; }
+    if (popcount64(s->sig[i] | s->sig[j]) > LUT_MAX_INPUTS) {
+        STAT_ADD(sig_rejects, 1);
+        STAT_ADD(union_rejects, 1);
+        return 0;
+    }
+    int fits = union_fits(s->in[i], na, s->in[j], nb);
+    if (!fits) STAT_ADD(union_rejects, 1);
+    return fits;
+}
+
+// The first-fit layouts: s is the SoA view, or NULL to read the Lut records
+// themselves (bench --layout). first_fit_scan is inlined into both callers
+// with a constant s, so each copy is specialised to one layout.
+#if defined(__GNUC__) || defined(__clang__)
+#define FF_INLINE static inline __attribute__((always_inline))
+#else
+#define FF_INLINE static inline
+#endif
+
+static inline int ff_used(const Lut *luts, const LutSoA *s, uint32_t i) {
+    return s ? soa_used(s, i) : luts[i].used;
+}
+
+static inline int ff_n(const Lut *luts, const LutSoA *s, uint32_t i) {
+    return s ? s->n[i] : luts[i].n;
+}
+
+static inline uint32_t ff_in(const Lut *luts, const LutSoA *s, uint32_t i, int k) {
+    return s ? s->in[i][k] : luts[i].in[k];
+}
+
+static inline int ff_depth_compatible(const Lut *luts, const LutSoA *s, uint32_t i, uint32_t j) {
+    return s ? soa_depth_compatible(s, i, j) : depth_compatible(&luts[i], &luts[j]);
+}
+
+static inline int ff_fits(const Lut *luts, const LutSoA *s, uint32_t i, uint32_t j) {
+    return s ? soa_fits(s, i, j) : union_unique_count_le6(&luts[i], &luts[j]);
+}
+
+static inline void ff_take(Lut *luts, LutSoA *s, uint32_t i) {
+    if (s) s->used[i / 64] |= 1ull << (i % 64);
+    else luts[i].used = 1;
+}
+
+FF_INLINE int first_fit_scan(Lut *luts, int n_luts, const FanoutIndex *fx, LutSoA *s,
+                             int *pair_a, int *pair_b) {
+    // Same result as scanning every later LUT j and taking the first one that
+    // fits, without the O(n^2) scan. A later j fits LUT i only if
+    //   - n_i + n_j <= 6 (fits whether or not they share a net), or
+    //   - j reads one of i's nets.
+    // The first case is served by the size buckets, the second by the fanout
+    // lists of i's nets. Both keep a cursor that only moves forward past LUTs
+    // that are <= i or already used.
+    int leveled = s ? s->level != NULL : n_luts > 0 && luts[0].leveled;
+    SizeBuckets sb;
+    build_size_buckets(luts, n_luts, &sb);
+    uint32_t small_cur[LUT_MAX_INPUTS + 1];
+    memcpy(small_cur, sb.start, sizeof(small_cur));
+    uint32_t *net_cur = (uint32_t*)xmalloc(((size_t)fx->n_nets + 1) * sizeof(uint32_t));
+    memcpy(net_cur, fx->offs, (size_t)fx->n_nets * sizeof(uint32_t));
+
+    int n_pairs = 0;
+    for (uint32_t i = 0; i < (uint32_t)n_luts; i++) {
+        int ni = ff_n(luts, s, i);
+        if (ff_used(luts, s, i) || ni > LUT_MAX_INPUTS) continue;
+        uint32_t best = UINT32_MAX;
+        STAT_ADD(candidate_luts, 1);
+
+        for (int b = 0; b <= LUT_MAX_INPUTS - ni; b++) {
+            uint32_t c = small_cur[b], e = sb.start[b + 1];
+            while (c < e && (sb.ids[c] <= i || ff_used(luts, s, sb.ids[c]))) c++;
+            small_cur[b] = c;
+            if (c < e) STAT_ADD(candidates, 1);
+            if (!leveled) {
+                if (c < e && sb.ids[c] < best) best = sb.ids[c];
+                continue;
+            }
+            // The cursor only passes LUTs that can never pair again; look
+            // past depth-incompatible ones without moving it.
+            for (int seen = 0; c < e && sb.ids[c] < best && seen < DEPTH_SCAN_LIMIT; c++) {
+                uint32_t j = sb.ids[c];
+                if (ff_used(luts, s, j)) continue;
+                if (ff_depth_compatible(luts, s, i, j)) { best = j; break; }
+                seen++;
+            }
+        }
+
+        // A size-bucket pick fits on n_i + n_j <= 6 without a union test;
+        // it is counted as a fast accept when it stays the partner.
+        uint32_t bucket_best = best;
+        for (int k = 0; k < ni; k++) {
+            uint32_t id = ff_in(luts, s, i, k);
+            uint32_t c = net_cur[id], e = fx->offs[id + 1];
+            while (c < e && (fx->luts[c] <= i || ff_used(luts, s, fx->luts[c]))) c++;
+            net_cur[id] = c;
+            for (; c < e; c++) {
+                uint32_t j = fx->luts[c];
+                if (j >= best) break;
+                if (ff_used(luts, s, j)) continue;
+                STAT_ADD(candidates, 1);
+                if (ff_fits(luts, s, i, j)) { best = j; break; }
+            }
+        }
+        if (best != UINT32_MAX && best == bucket_best) {
+            STAT_ADD(union_calls, 1);
+            STAT_ADD(union_fast, 1);
+        }
+
+        if (best != UINT32_MAX) {
+            ff_take(luts, s, i);
+            ff_take(luts, s, best);
+            pair_a[n_pairs] = (int)i;
+            pair_b[n_pairs] = (int)best;
+            n_pairs++;
+        }
+    }
+
+    free_size_buckets(&sb);
+    free(net_cur);
+    return n_pairs;
+}
+
+static int pair_first_fit(Lut *luts, int n_luts, const FanoutIndex *fx, int *pair_a, int *pair_b) {
+    // first_fit_scan on a LutSoA copy; the used flags of the LUTs it pairs
+    // are written back at the end.
+    LutSoA s;
+    lut_soa_build(luts, n_luts, &s);
+    int n_pairs = first_fit_scan(luts, n_luts, fx, &s, pair_a, pair_b);
+    for (int k = 0; k < n_pairs; k++) luts[pair_a[k]].used = luts[pair_b[k]].used = 1;
+    lut_soa_free(&s);
+    return n_pairs;
+}
+
+static int pair_first_fit_aos(Lut *luts, int n_luts, const FanoutIndex *fx, int *pair_a, int *pair_b) {
+    // first_fit_scan on the Lut records, as before the SoA view; the
+    // reference for bench --layout.
+    return first_fit_scan(luts, n_luts, fx, NULL, pair_a, pair_b);
+}
+
+static double now_seconds(void) {
+    // Monotonic wall clock.
+#if defined(__unix__) || defined(__APPLE__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#else
+    return (double)clock() / (double)CLOCKS_PER_SEC;
+#endif
+}
+
+// Sparse LUT compatibility graph in CSR form: the neighbours of LUT v are
+// adj[offs[v] .. offs[v + 1]). Every edge joins two LUTs whose input union
+// is at most six and is stored in both rows. Under --compact the rows are
+// packed instead: row v is packed[pos[v] .. pos[v + 1]), its ascending
+// neighbours as LEB128 deltas (the first from 0), and adj is NULL; offs
+// still counts neighbours. Walk rows with graph_row / graph_next, which
+// read either layout.
+typedef struct {
+    uint32_t n;
+    uint32_t *offs;
+    uint32_t *adj;
+    uint8_t *packed;
+    size_t *pos;
+} CompatGraph;
+
+typedef struct {
+    const uint32_t *adj;
+    const uint8_t *p;
+    uint32_t k;         // position of the next neighbour, as in offs
+    uint32_t end;
+    uint32_t u;         // current neighbour, after graph_next returned 1
+} GraphRow;
+
+static uint32_t get_varint(const uint8_t **p) {
+    uint32_t v = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+        b = *(*p)++;
+        v |= (uint32_t)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return v;
+}
+
+static int varint_len(uint32_t v) {
+    int n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+static uint8_t *put_varint(uint8_t *p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline GraphRow graph_row(const CompatGraph *g, uint32_t v) {
+    GraphRow r;
+    r.adj = g->adj;
+    r.p = g->packed ? g->packed + g->pos[v] : NULL;
+    r.k = g->offs[v];
+    r.end = g->offs[v + 1];
+    r.u = 0;
+    return r;
+}
+
+static inline int graph_next(GraphRow *r) {
+    if (r->k == r->end) return 0;
+    r->u = r->adj ? r->adj[r->k] : r->u + get_varint(&r->p);
+    r->k++;
+    return 1;
+}
+
+typedef struct {
+    uint32_t *uv;    // edge k is (uv[2k], uv[2k+1]), first endpoint smaller
+    size_t n;
+    size_t cap;
+} EdgeList;
+
+static void edge_push(EdgeList *el, uint32_t u, uint32_t v) {
+    if (el->n == el->cap) {
+        el->cap = el->cap ? el->cap * 2 : 4096;
+        el->uv = (uint32_t*)xrealloc(el->uv, el->cap * 2 * sizeof(uint32_t));
+    }
+    el->uv[2 * el->n] = u;
+    el->uv[2 * el->n + 1] = v;
+    el->n++;
+}
+
+// Minimal fork/join helper: runs fn(arg, tid, n_threads) on n_threads
+// threads, the caller being thread 0. Without pthreads (or if a thread cannot
+// be started) the remaining tids run in the caller, one after another.
+typedef void (*ParallelFn)(void *arg, int tid, int n_threads);
+
+#ifdef LUTPAIR_THREADS
+typedef struct {
+    ParallelFn fn;
+    void *arg;
+    int tid;
+    int n_threads;
+} ParallelJob;
+
+static void *parallel_trampoline(void *p) {
+    ParallelJob *job = (ParallelJob*)p;
+    job->fn(job->arg, job->tid, job->n_threads);
+    return NULL;
+}
+#endif
+
+static void parallel_run(int n_threads, ParallelFn fn, void *arg) {
+    if (n_threads < 1) n_threads = 1;
+#ifdef LUTPAIR_THREADS
+    if (n_threads > 1) {
+        pthread_t *th = (pthread_t*)xmalloc((size_t)n_threads * sizeof(pthread_t));
+        ParallelJob *jobs = (ParallelJob*)xmalloc((size_t)n_threads * sizeof(ParallelJob));
+        uint8_t *started = (uint8_t*)calloc((size_t)n_threads, 1);
+        if (!started) { fprintf(stderr, "OOM\n"); exit(1); }
+        for (int t = 1; t < n_threads; t++) {
+            jobs[t].fn = fn;
+            jobs[t].arg = arg;
+            jobs[t].tid = t;
+            jobs[t].n_threads = n_threads;
+            started[t] = pthread_create(&th[t], NULL, parallel_trampoline, &jobs[t]) == 0;
+        }
+        fn(arg, 0, n_threads);
+        for (int t = 1; t < n_threads; t++) {
+            if (started[t]) pthread_join(th[t], NULL);
+            else fn(arg, t, n_threads);
+        }
+        free(started);
+        free(jobs);
+        free(th);
+        return;
+    }
+#endif
+    for (int t = 0; t < n_threads; t++) fn(arg, t, n_threads);
+}
+
+static uint32_t lower_bound_u32(const uint32_t *a, uint32_t lo, uint32_t hi, uint32_t key) {
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (a[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void sort_u32(uint32_t *a, size_t n) {
+    // Quicksort (median of three) with insertion sort for short runs; rows
+    // are mostly short, and this avoids qsort's per-compare callback.
+    while (n > 16) {
+        uint32_t x = a[0], y = a[n / 2], z = a[n - 1];
+        uint32_t pivot = x < y ? (y < z ? y : (x < z ? z : x)) : (x < z ? x : (y < z ? z : y));
+        size_t i = 0, j = n - 1;
+        for (;;) {
+            while (a[i] < pivot) i++;
+            while (a[j] > pivot) j--;
+            if (i >= j) break;
+            uint32_t t = a[i]; a[i] = a[j]; a[j] = t;
+            i++;
+            j--;
+        }
+        // Recurse into the smaller half, loop on the larger.
+        if (j + 1 < n - j - 1) {
+            sort_u32(a, j + 1);
+            a += j + 1;
+            n -= j + 1;
+        } else {
+            sort_u32(a + j + 1, n - j - 1);
+            n = j + 1;
+        }
+    }
+    for (size_t i = 1; i < n; i++) {
+        uint32_t v = a[i];
+        size_t k = i;
+        while (k > 0 && a[k - 1] > v) { a[k] = a[k - 1]; k--; }
+        a[k] = v;
+    }
+}
+
+static void net_graph_csr(const NetGraph *ng, uint32_t n_rows, int by_cell, uint32_t is_output,
+                          uint32_t **offs_out, uint32_t **vals_out) {
+    // One direction of the pin list as CSR: rows are cells (by_cell) or nets,
+    // restricted to output or input pins; each row is sorted and deduplicated
+    // (a cell may read one net on several pins).
+    uint32_t *offs = (uint32_t*)calloc((size_t)n_rows + 1, sizeof(uint32_t));
+    if (!offs) { fprintf(stderr, "OOM\n"); exit(1); }
+    for (size_t k = 0; k < ng->n_pins; k += 3) {
+        if (ng->pins[k + 2] == is_output) offs[ng->pins[k + by_cell] + 1]++;
+    }
+    for (uint32_t r = 0; r < n_rows; r++) offs[r + 1] += offs[r];
+    uint32_t *vals = (uint32_t*)xmalloc((size_t)offs[n_rows] * sizeof(uint32_t) + 1);
+    uint32_t *fill = (uint32_t*)xmalloc((size_t)n_rows * sizeof(uint32_t) + 1);
+    memcpy(fill, offs, (size_t)n_rows * sizeof(uint32_t));
+    for (size_t k = 0; k < ng->n_pins; k += 3) {
+        if (ng->pins[k + 2] == is_output) vals[fill[ng->pins[k + by_cell]]++] = ng->pins[k + !by_cell];
+    }
+    free(fill);
+
+    uint32_t w = 0;
+    for (uint32_t r = 0; r < n_rows; r++) {
+        uint32_t lo = offs[r], hi = offs[r + 1];
+        sort_u32(vals + lo, hi - lo);
+        offs[r] = w;
+        for (uint32_t k = lo; k < hi; k++) {
+            if (k == lo || vals[k] != vals[k - 1]) vals[w++] = vals[k];
+        }
+    }
+    offs[n_rows] = w;
+    *offs_out = offs;
+    *vals_out = vals;
+}
+
+static void net_graph_finish(NetGraph *ng, uint32_t n_luts) {
+    // Resolves parse-time cell tags now that the LUT count is known, builds
+    // the four CSR views and drops the pin list.
+    ng->n_luts = n_luts;
+    ng->n_cells = n_luts + ng->n_other;
+    for (size_t k = 1; k < ng->n_pins; k += 3) {
+        if (ng->pins[k] & CELL_PENDING_OTHER) ng->pins[k] = n_luts + (ng->pins[k] & ~CELL_PENDING_OTHER);
+    }
+    uint32_t n_nets = ng->nets.count;
+    net_graph_csr(ng, n_nets, 0, 1, &ng->drv_offs, &ng->drv);
+    net_graph_csr(ng, n_nets, 0, 0, &ng->sink_offs, &ng->sink);
+    net_graph_csr(ng, ng->n_cells, 1, 1, &ng->out_offs, &ng->out);
+    net_graph_csr(ng, ng->n_cells, 1, 0, &ng->in_offs, &ng->in);
+    free(ng->pins);
+    ng->pins = NULL;
+    ng->cap_pins = 0;
+
+    ng->cell_comb = (uint8_t*)xmalloc((size_t)ng->n_cells + 1);
+    memset(ng->cell_comb, 1, n_luts);
+    if (ng->n_other) memcpy(ng->cell_comb + n_luts, ng->other_comb, ng->n_other);
+}
+
+// Levelization of the combinational logic. Registers, RAM, DSP blocks and
+// pads are boundaries: their outputs start paths and their inputs end them.
+// level[c] is the longest chain of combinational cells from a boundary to c
+// (1 = fed only by boundaries), height[c] the longest chain from c to a
+// boundary, and level + height - 1 the longest path through c. The critical
+// depth is the maximum of that over all cells and a cell's slack is how far
+// short of it its longest path falls. Kahn's algorithm, linear in the pins;
+// cells on a combinational loop (never released) keep the level they had
+// reached and a height of 1. Results go to luts[].level / .slack.
+typedef struct {
+    uint32_t depth;       // critical path length in combinational cells
+    uint32_t critical;    // LUTs with zero slack
+    uint32_t looped;      // combinational cells on a loop
+} LevelStats;
+
+static void levelize(const NetGraph *ng, Lut *luts, LevelStats *st) {
+    uint32_t n = ng->n_cells;
+    uint32_t *indeg = (uint32_t*)calloc((size_t)n + 1, sizeof(uint32_t));
+    uint32_t *level = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    uint32_t *height = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    uint32_t *order = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    if (!indeg) { fprintf(stderr, "OOM\n"); exit(1); }
+
+    uint32_t n_comb = 0;
+    for (uint32_t c = 0; c < n; c++) {
+        level[c] = 1;
+        height[c] = 1;
+        if (!ng->cell_comb[c]) continue;
+        n_comb++;
+        for (uint32_t k = ng->in_offs[c]; k < ng->in_offs[c + 1]; k++) {
+            uint32_t net = ng->in[k];
+            for (uint32_t d = ng->drv_offs[net]; d < ng->drv_offs[net + 1]; d++) {
+                indeg[c] += ng->cell_comb[ng->drv[d]];
+            }
+        }
+    }
+
+    // order doubles as the FIFO: cells are appended when released.
+    uint32_t head = 0, tail = 0;
+    for (uint32_t c = 0; c < n; c++) {
+        if (ng->cell_comb[c] && indeg[c] == 0) order[tail++] = c;
+    }
+    while (head < tail) {
+        uint32_t c = order[head++];
+        for (uint32_t k = ng->out_offs[c]; k < ng->out_offs[c + 1]; k++) {
+            uint32_t net = ng->out[k];
+            for (uint32_t q = ng->sink_offs[net]; q < ng->sink_offs[net + 1]; q++) {
+                uint32_t s = ng->sink[q];
+                if (!ng->cell_comb[s]) continue;
+                if (level[c] + 1 > level[s]) level[s] = level[c] + 1;
+                if (--indeg[s] == 0) order[tail++] = s;
+            }
+        }
+    }
+    for (uint32_t k = tail; k-- > 0;) {
+        uint32_t c = order[k];
+        for (uint32_t o = ng->out_offs[c]; o < ng->out_offs[c + 1]; o++) {
+            uint32_t net = ng->out[o];
+            for (uint32_t q = ng->sink_offs[net]; q < ng->sink_offs[net + 1]; q++) {
+                uint32_t s = ng->sink[q];
+                if (ng->cell_comb[s] && height[s] + 1 > height[c]) height[c] = height[s] + 1;
+            }
+        }
+    }
+
+    uint32_t depth = 0;
+    for (uint32_t c = 0; c < n; c++) {
+        if (ng->cell_comb[c] && level[c] + height[c] - 1 > depth) depth = level[c] + height[c] - 1;
+    }
+    st->depth = depth;
+    st->critical = 0;
+    st->looped = n_comb - tail;
+    for (uint32_t c = 0; c < ng->n_luts; c++) {
+        uint32_t slack = depth - (level[c] + height[c] - 1);
+        luts[c].level = (uint16_t)(level[c] > UINT16_MAX ? UINT16_MAX : level[c]);
+        luts[c].slack = (uint16_t)(slack > UINT16_MAX ? UINT16_MAX : slack);
+        luts[c].leveled = 1;
+        st->critical += (slack == 0);
+    }
+    free(indeg);
+    free(level);
+    free(height);
+    free(order);
+}
+
+// Parallel compatibility-graph construction. Rows are handed out in chunks
+// through an atomic counter; each thread appends edges (i, j > i) for its
+// rows to its own EdgeList, so the hot loop takes no locks. The lists are
+// then counted into row offsets with a prefix sum and scattered with atomic
+// cursors. Rows are generated in ascending order, so with one thread the
+// scatter leaves every row sorted; with more, rows that came out of order are
+// sorted afterwards. Either way the graph does not depend on the thread count
+// or on the order in which chunks were claimed. A packed (--compact) graph
+// skips the edge lists: each chunk's forward rows are packed as soon as
+// they are generated, and pack_compat_graph then writes the full rows from
+// them in two ascending passes. With a deadline, every GRAPH_CHECK_ROWS rows
+// check the clock and project the finish from the work done so far, work
+// being a row plus the forward fanout entries it merges (early rows merge
+// far more than late ones, so rows alone are no measure). An incomplete
+// graph is thrown away, so the build gives up as soon as the projection
+// overruns the deadline.
+#define GRAPH_CHUNK 1024
+#define GRAPH_CHECK_ROWS 32
+#define GRAPH_MAX_FREE_EDGES 64
+#define GRAPH_FREE_ALL INT_MAX  // free_edges for --matcher=exact: every free pair
+
+typedef struct {
+    const Lut *luts;
+    int n_luts;
+    const FanoutIndex *fx;
+    const SizeBuckets *sb;
+    int free_edges;
+    int n_threads;
+    uint32_t next_chunk;
+    double deadline;        // stop generating rows after this (0 = never)
+    double start;           // when row generation began
+    double total_work;      // rows plus forward fanout entries, over the whole graph
+    double *work;           // per thread: work done as of its last check
+    int aborted;
+    double projected;       // seconds the whole build looked like needing when it gave up; 0 = deadline hit
+    EdgeList *edges;        // one per thread
+    CompatGraph *g;
+    uint32_t *fill;
+    uint8_t **chunks;       // packed: chunk c's rows, each a count then deltas from the row's LUT
+} GraphBuild;
+
+static int graph_out_of_time(GraphBuild *gb, double *work, double *pending) {
+    // Folds this thread's pending work into its slot; the other slots are
+    // read as they stand.
+    if (gb->aborted) return 1;
+    double now = now_seconds(), done = 0.0;
+    *work += *pending;
+    *pending = 0.0;
+    for (int t = 0; t < gb->n_threads; t++) done += gb->work[t];
+    double need = (now - gb->start) * gb->total_work / done;
+    if (now > gb->deadline) {
+        gb->aborted = 1;    // benign race: every writer stores 1
+        return 1;
+    }
+    if (gb->start + need > gb->deadline) {
+        gb->projected = need;
+        gb->aborted = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int graph_gen_rows(GraphBuild *gb, EdgeList *el, double *work, uint32_t *extra_all, uint32_t lo, uint32_t hi) {
+    // Returns 0 if the deadline (see graph_out_of_time) stopped it first.
+    // Edges come from two sources:
+    //   - LUTs sharing a net whose union fits (found through the fanout index);
+    //   - "free" pairs with n_i + n_j <= 6, which fit without sharing. These
+    //     would make the graph dense among small LUTs, so each LUT only gets
+    //     `free_edges` forward edges per partner size: free-class LUTs seen
+    //     through a shared net first, then the next LUTs of the size bucket.
+    //     With GRAPH_FREE_ALL every free pair is an edge; extra_all then
+    //     holds a row's free partners (n_luts entries).
+    const Lut *luts = gb->luts;
+    const FanoutIndex *fx = gb->fx;
+    const SizeBuckets *sb = gb->sb;
+    uint32_t checked = lo;
+    double pending = 0.0;
+    for (uint32_t i = lo; i < hi; i++) {
+        if (gb->deadline > 0 && i - checked == GRAPH_CHECK_ROWS) {
+            if (graph_out_of_time(gb, work, &pending)) return 0;
+            checked = i;
+        }
+        pending += 1.0;
+        const Lut *a = &luts[i];
+        if (a->n > LUT_MAX_INPUTS) continue;
+        int taken[LUT_MAX_INPUTS + 1] = {0};
+        STAT_ADD(candidate_luts, 1);
+
+        // Merge the (ascending) fanout lists of i's nets, from j > i on, so
+        // every sharing LUT is seen once and in order.
+        uint32_t pos[LUT_MAX_INPUTS], end[LUT_MAX_INPUTS];
+        for (int k = 0; k < a->n; k++) {
+            uint32_t id = a->in[k];
+            end[k] = fx->offs[id + 1];
+            pos[k] = lower_bound_u32(fx->luts, fx->offs[id], end[k], i + 1);
+            pending += end[k] - pos[k];
+        }
+        size_t seg = el->n;
+        for (;;) {
+            uint32_t j = UINT32_MAX;
+            for (int k = 0; k < a->n; k++) {
+                if (pos[k] < end[k] && fx->luts[pos[k]] < j) j = fx->luts[pos[k]];
+            }
+            if (j == UINT32_MAX) break;
+            for (int k = 0; k < a->n; k++) {
+                if (pos[k] < end[k] && fx->luts[pos[k]] == j) pos[k]++;
+            }
+            STAT_ADD(candidates, 1);
+            int nj = luts[j].n;
+            if (a->n + nj <= LUT_MAX_INPUTS) {
+                if (taken[nj] < gb->free_edges && (!a->leveled || depth_compatible(a, &luts[j]))) {
+                    taken[nj]++;
+                    edge_push(el, i, j);
+                }
+            } else if (union_unique_count_le6(a, &luts[j])) {
+                edge_push(el, i, j);
+            }
+        }
+        size_t seg_end = el->n;
+
+        // Free partners from the size buckets, minus those already linked
+        // through a shared net (that segment of the edge list is ascending).
+        uint32_t extra[(LUT_MAX_INPUTS + 1) * GRAPH_MAX_FREE_EDGES];
+        int n_extra = 0;
+        uint32_t *ex = extra_all ? extra_all : extra;
+        for (int s = 0; s <= LUT_MAX_INPUTS - a->n; s++) {
+            uint32_t c = lower_bound_u32(sb->ids, sb->start[s], sb->start[s + 1], i + 1);
+            int skipped = 0;
+            for (; c < sb->start[s + 1] && taken[s] < gb->free_edges; c++) {
+                uint32_t j = sb->ids[c];
+                if (a->leveled && !depth_compatible(a, &luts[j])) {
+                    if (++skipped >= DEPTH_SCAN_LIMIT && ex == extra) break;
+                    continue;
+                }
+                size_t l = seg, h = seg_end;
+                while (l < h) {
+                    size_t m = l + (h - l) / 2;
+                    if (el->uv[2 * m + 1] < j) l = m + 1;
+                    else h = m;
+                }
+                if (l < seg_end && el->uv[2 * l + 1] == j) continue;
+                taken[s]++;
+                ex[n_extra++] = j;
+            }
+        }
+        if (n_extra == 0) continue;
+
+        // Merge them in from the back so the whole row stays ascending.
+        sort_u32(ex, (size_t)n_extra);
+        for (int k = 0; k < n_extra; k++) edge_push(el, i, 0);
+        size_t w = el->n, r = seg_end;
+        int x = n_extra;
+        while (x > 0) {
+            w--;
+            if (r > seg && el->uv[2 * (r - 1) + 1] > ex[x - 1]) {
+                el->uv[2 * w + 1] = el->uv[2 * (r - 1) + 1];
+                r--;
+            } else {
+                el->uv[2 * w + 1] = ex[--x];
+            }
+        }
+    }
+    return gb->deadline <= 0 || !graph_out_of_time(gb, work, &pending);
+}
+
+static void graph_gen_worker(void *arg, int tid, int n_threads) {
+    (void)n_threads;
+    GraphBuild *gb = (GraphBuild*)arg;
+    uint32_t *extra_all = NULL;
+    if (gb->free_edges > GRAPH_MAX_FREE_EDGES)
+        extra_all = (uint32_t*)xmalloc((size_t)gb->n_luts * sizeof(uint32_t) + 1);
+    for (;;) {
+        if (gb->aborted) break;
+        uint32_t lo = atomic_add_u32(&gb->next_chunk, GRAPH_CHUNK);
+        if (lo >= (uint32_t)gb->n_luts) break;
+        uint32_t hi = lo + GRAPH_CHUNK;
+        if (hi > (uint32_t)gb->n_luts) hi = (uint32_t)gb->n_luts;
+        if (!gb->chunks) {
+            if (!graph_gen_rows(gb, &gb->edges[tid], &gb->work[tid], extra_all, lo, hi)) break;
+            continue;
+        }
+        EdgeList *el = &gb->edges[tid];
+        el->n = 0;
+        if (!graph_gen_rows(gb, el, &gb->work[tid], extra_all, lo, hi)) break;
+        size_t bytes = 0;
+        for (size_t k = 0, e = 0; k < hi - lo; k++) {
+            uint32_t i = lo + (uint32_t)k, prev = i, cnt = 0;
+            for (; e < el->n && el->uv[2 * e] == i; e++) {
+                bytes += varint_len(el->uv[2 * e + 1] - prev);
+                prev = el->uv[2 * e + 1];
+                cnt++;
+            }
+            bytes += varint_len(cnt);
+        }
+        uint8_t *out = (uint8_t*)xmalloc(bytes + 1);
+        gb->chunks[lo / GRAPH_CHUNK] = out;
+        for (uint32_t i = lo, e = 0; i < hi; i++) {
+            uint32_t e_end = (uint32_t)e, prev = i;
+            while (e_end < el->n && el->uv[2 * e_end] == i) e_end++;
+            out = put_varint(out, e_end - (uint32_t)e);
+            for (; e < e_end; e++) {
+                out = put_varint(out, el->uv[2 * e + 1] - prev);
+                prev = el->uv[2 * e + 1];
+            }
+        }
+    }
+    free(extra_all);
+}
+
+static void pack_pass(const GraphBuild *gb, uint32_t *last, int write) {
+    // Forward rows in ascending order: row i has its backward neighbours
+    // (all below i, appended while the rows before it went by) before the
+    // forward ones, so every row comes out ascending. The first pass sizes
+    // the rows into offs/pos, the second writes them, leaving pos[v] at the
+    // end of row v.
+    CompatGraph *g = gb->g;
+    memset(last, 0, (size_t)g->n * sizeof(uint32_t));
+    for (uint32_t lo = 0; lo < g->n; lo += GRAPH_CHUNK) {
+        const uint8_t *p = gb->chunks[lo / GRAPH_CHUNK];
+        uint32_t hi = lo + GRAPH_CHUNK < g->n ? lo + GRAPH_CHUNK : g->n;
+        for (uint32_t i = lo; i < hi; i++) {
+            uint32_t cnt = get_varint(&p), j = i;
+            for (uint32_t q = 0; q < cnt; q++) {
+                j += get_varint(&p);
+                if (write) {
+                    g->pos[i] = (size_t)(put_varint(g->packed + g->pos[i], j - last[i]) - g->packed);
+                    g->pos[j] = (size_t)(put_varint(g->packed + g->pos[j], i - last[j]) - g->packed);
+                } else {
+                    g->pos[i + 1] += (size_t)varint_len(j - last[i]);
+                    g->pos[j + 1] += (size_t)varint_len(i - last[j]);
+                    g->offs[i + 1]++;
+                    g->offs[j + 1]++;
+                }
+                last[i] = j;
+                last[j] = i;
+            }
+        }
+    }
+}
+
+static void pack_compat_graph(GraphBuild *gb) {
+    CompatGraph *g = gb->g;
+    uint32_t n = g->n;
+    uint32_t *last = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    g->pos = (size_t*)calloc((size_t)n + 1, sizeof(size_t));
+    if (!g->pos) { fprintf(stderr, "OOM\n"); exit(1); }
+    pack_pass(gb, last, 0);
+    for (uint32_t v = 0; v < n; v++) {
+        g->offs[v + 1] += g->offs[v];
+        g->pos[v + 1] += g->pos[v];
+    }
+    g->packed = (uint8_t*)xmalloc(g->pos[n] + 1);
+    pack_pass(gb, last, 1);
+    for (uint32_t v = n; v > 0; v--) g->pos[v] = g->pos[v - 1];
+    g->pos[0] = 0;
+    free(last);
+}
+
+static void graph_count_worker(void *arg, int tid, int n_threads) {
+    (void)n_threads;
+    GraphBuild *gb = (GraphBuild*)arg;
+    const EdgeList *el = &gb->edges[tid];
+    for (size_t k = 0; k < el->n; k++) {
+        atomic_add_u32(&gb->g->offs[el->uv[2 * k] + 1], 1);
+        atomic_add_u32(&gb->g->offs[el->uv[2 * k + 1] + 1], 1);
+    }
+}
+
+static void graph_scatter_worker(void *arg, int tid, int n_threads) {
+    (void)n_threads;
+    GraphBuild *gb = (GraphBuild*)arg;
+    const EdgeList *el = &gb->edges[tid];
+    uint32_t *adj = gb->g->adj;
+    for (size_t k = 0; k < el->n; k++) {
+        uint32_t u = el->uv[2 * k], v = el->uv[2 * k + 1];
+        adj[atomic_add_u32(&gb->fill[u], 1)] = v;
+        adj[atomic_add_u32(&gb->fill[v], 1)] = u;
+    }
+}
+
+static void graph_sort_worker(void *arg, int tid, int n_threads) {
+    GraphBuild *gb = (GraphBuild*)arg;
+    const CompatGraph *g = gb->g;
+    uint32_t per = (g->n + (uint32_t)n_threads - 1) / (uint32_t)n_threads;
+    uint32_t lo = per * (uint32_t)tid, hi = lo + per;
+    if (hi > g->n) hi = g->n;
+    for (uint32_t v = lo; v < hi; v++) {
+        uint32_t *row = g->adj + g->offs[v];
+        uint32_t d = g->offs[v + 1] - g->offs[v];
+        uint32_t k = 1;
+        while (k < d && row[k - 1] < row[k]) k++;
+        if (k < d) sort_u32(row, d);
+    }
+}
+
+static int build_compat_graph(const Lut *luts, int n_luts, const FanoutIndex *fx, int free_edges,
+                              int n_threads, double deadline, int packed, CompatGraph *g, double *projected) {
+    // Returns 0, leaving g empty, if the deadline cut row generation short;
+    // *projected is then the estimated time for the whole build if it gave
+    // up early because that would not fit, else 0.
+    if (n_threads < 1) n_threads = 1;
+    SizeBuckets sb;
+    build_size_buckets(luts, n_luts, &sb);
+
+    GraphBuild gb;
+    gb.luts = luts;
+    gb.n_luts = n_luts;
+    gb.fx = fx;
+    gb.sb = &sb;
+    gb.free_edges = free_edges;
+    gb.next_chunk = 0;
+    gb.n_threads = n_threads;
+    gb.deadline = deadline;
+    gb.total_work = n_luts;
+    for (uint32_t id = 0; id < fx->n_nets; id++) {
+        double m = fx->offs[id + 1] - fx->offs[id];
+        gb.total_work += m * (m - 1) / 2;
+    }
+    gb.work = (double*)calloc((size_t)n_threads, sizeof(double));
+    if (!gb.work) { fprintf(stderr, "OOM\n"); exit(1); }
+    gb.aborted = 0;
+    gb.projected = 0.0;
+    gb.start = now_seconds();
+    gb.edges = (EdgeList*)calloc((size_t)n_threads, sizeof(EdgeList));
+    if (!gb.edges) { fprintf(stderr, "OOM\n"); exit(1); }
+    gb.g = g;
+    size_t n_chunks = ((size_t)n_luts + GRAPH_CHUNK - 1) / GRAPH_CHUNK;
+    gb.chunks = NULL;
+    if (packed) {
+        gb.chunks = (uint8_t**)calloc(n_chunks + 1, sizeof(uint8_t*));
+        if (!gb.chunks) { fprintf(stderr, "OOM\n"); exit(1); }
+    }
+    parallel_run(n_threads, graph_gen_worker, &gb);
+    free_size_buckets(&sb);
+    free(gb.work);
+    *projected = gb.projected;
+    if (gb.aborted) {
+        for (int t = 0; t < n_threads; t++) free(gb.edges[t].uv);
+        if (packed) for (size_t c = 0; c < n_chunks; c++) free(gb.chunks[c]);
+        free(gb.chunks);
+        free(gb.edges);
+        memset(g, 0, sizeof(*g));
+        return 0;
+    }
+
+    g->n = (uint32_t)n_luts;
+    g->offs = (uint32_t*)calloc((size_t)n_luts + 1, sizeof(uint32_t));
+    if (!g->offs) { fprintf(stderr, "OOM\n"); exit(1); }
+    if (packed) {
+        for (int t = 0; t < n_threads; t++) free(gb.edges[t].uv);
+        g->adj = NULL;
+        pack_compat_graph(&gb);
+        for (size_t c = 0; c < n_chunks; c++) free(gb.chunks[c]);
+        free(gb.chunks);
+        free(gb.edges);
+        return 1;
+    }
+    parallel_run(n_threads, graph_count_worker, &gb);
+    for (int v = 0; v < n_luts; v++) g->offs[v + 1] += g->offs[v];
+
+    g->adj = (uint32_t*)xmalloc((size_t)g->offs[n_luts] * sizeof(uint32_t) + 1);
+    gb.fill = (uint32_t*)xmalloc(((size_t)n_luts + 1) * sizeof(uint32_t));
+    memcpy(gb.fill, g->offs, (size_t)n_luts * sizeof(uint32_t));
+    parallel_run(n_threads, graph_scatter_worker, &gb);
+    parallel_run(n_threads, graph_sort_worker, &gb);
+
+    free(gb.fill);
+    for (int t = 0; t < n_threads; t++) free(gb.edges[t].uv);
+    free(gb.edges);
+    return !gb.aborted;
+}
+
+static void free_compat_graph(CompatGraph *g) {
+    free(g->offs);
+    free(g->adj);
+    free(g->packed);
+    free(g->pos);
+    g->offs = g->adj = NULL;
+    g->packed = NULL;
+    g->pos = NULL;
+}
+
+// Maximum-cardinality matching on a general graph (Edmonds' blossom
+// algorithm), grown from an existing matching by repeated augmenting-path
+// searches. All per-search state is reset through a touched-vertex list, so a
+// search costs time proportional to the tree it builds, not to the graph.
+// A search that finds no augmenting path leaves a tree that can never be
+// part of one later either, so its vertices are retired for good.
+typedef struct {
+    const CompatGraph *g;
+    int32_t *match;     // partner or -1
+    int32_t *parent;    // tree parent of odd vertices, -1 otherwise
+    uint32_t *base;     // blossom base
+    uint8_t *even;      // in tree at even distance from the root
+    uint8_t *in_blossom;
+    uint8_t *dead;
+    uint32_t *lca_mark;
+    uint32_t lca_stamp;
+    uint32_t *queue;
+    uint32_t *touched;
+    uint32_t n_touched;
+} Blossom;
+
+static void blossom_touch(Blossom *b, uint32_t v) {
+    b->touched[b->n_touched++] = v;
+}
+
+static uint32_t blossom_lca(Blossom *b, uint32_t x, uint32_t y) {
+    // Lowest common ancestor (as blossom bases) of two even vertices.
+    uint32_t stamp = ++b->lca_stamp;
+    for (;;) {
+        x = b->base[x];
+        b->lca_mark[x] = stamp;
+        if (b->match[x] == -1) break; // reached the root
+        x = (uint32_t)b->parent[b->match[x]];
+    }
+    for (;;) {
+        y = b->base[y];
+        if (b->lca_mark[y] == stamp) return y;
+        y = (uint32_t)b->parent[b->match[y]];
+    }
+}
+
+static void blossom_mark_path(Blossom *b, uint32_t v, uint32_t top, uint32_t child) {
+    while (b->base[v] != top) {
+        uint32_t m = (uint32_t)b->match[v];
+        b->in_blossom[b->base[v]] = 1;
+        b->in_blossom[b->base[m]] = 1;
+        b->parent[v] = (int32_t)child;
+        child = m;
+        v = (uint32_t)b->parent[m];
+    }
+}
+
+static int blossom_augment_from(Blossom *b, uint32_t root) {
+    // BFS over alternating paths from an unmatched root; on success flips the
+    // path and returns 1.
+    const CompatGraph *g = b->g;
+    uint32_t qh = 0, qt = 0;
+    b->n_touched = 0;
+    blossom_touch(b, root);
+    b->even[root] = 1;
+    b->queue[qt++] = root;
+    int found = 0;
+    uint32_t end_v = 0;
+
+    while (qh < qt && !found) {
+        uint32_t v = b->queue[qh++];
+        for (GraphRow r = graph_row(g, v); graph_next(&r); ) {
+            uint32_t to = r.u;
+            if (b->dead[to] || b->base[v] == b->base[to] || b->match[v] == (int32_t)to) continue;
+            if (to == root || (b->match[to] != -1 && b->parent[b->match[to]] != -1)) {
+                // Odd cycle: contract the blossom onto its base.
+                uint32_t top = blossom_lca(b, v, to);
+                for (uint32_t t = 0; t < b->n_touched; t++) b->in_blossom[b->base[b->touched[t]]] = 0;
+                blossom_mark_path(b, v, top, to);
+                blossom_mark_path(b, to, top, v);
+                uint32_t nt = b->n_touched;
+                for (uint32_t t = 0; t < nt; t++) {
+                    uint32_t u = b->touched[t];
+                    if (b->in_blossom[b->base[u]]) {
+                        b->base[u] = top;
+                        if (!b->even[u]) {
+                            b->even[u] = 1;
+                            b->queue[qt++] = u;
+                        }
+                    }
+                }
+            } else if (b->parent[to] == -1) {
+                b->parent[to] = (int32_t)v;
+                blossom_touch(b, to);
+                if (b->match[to] == -1) { found = 1; end_v = to; break; }
+                uint32_t m = (uint32_t)b->match[to];
+                blossom_touch(b, m);
+                b->even[m] = 1;
+                b->queue[qt++] = m;
+            }
+        }
+    }
+
+    if (found) {
+        uint32_t v = end_v;
+        while (v != UINT32_MAX) {
+            uint32_t pv = (uint32_t)b->parent[v];
+            uint32_t ppv = b->match[pv] == -1 ? UINT32_MAX : (uint32_t)b->match[pv];
+            b->match[v] = (int32_t)pv;
+            b->match[pv] = (int32_t)v;
+            v = ppv;
+        }
+    }
+
+    for (uint32_t t = 0; t < b->n_touched; t++) {
+        uint32_t u = b->touched[t];
+        if (!found) b->dead[u] = 1;
+        b->parent[u] = -1;
+        b->base[u] = u;
+        b->even[u] = 0;
+        b->in_blossom[u] = 0;
+    }
+    return found;
+}
+
+// Called by match_blossom after each successful augmentation with the
+// current matching and the augmentations so far.
+typedef void (*MatchProgressFn)(void *arg, const int32_t *match, int augmented);
+
+static int match_blossom(const CompatGraph *g, int32_t *match, double budget_s, int *timed_out,
+                         MatchProgressFn progress, void *progress_arg) {
+    // Grows `match` (partner or -1 per vertex) to a maximum matching of g, or
+    // as far as the time budget allows. Returns the number of augmentations.
+    uint32_t n = g->n;
+    Blossom b;
+    b.g = g;
+    b.match = match;
+    b.parent = (int32_t*)xmalloc((size_t)n * sizeof(int32_t) + 1);
+    b.base = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    b.even = (uint8_t*)calloc((size_t)n + 1, 1);
+    b.in_blossom = (uint8_t*)calloc((size_t)n + 1, 1);
+    b.dead = (uint8_t*)calloc((size_t)n + 1, 1);
+    b.lca_mark = (uint32_t*)calloc((size_t)n + 1, sizeof(uint32_t));
+    b.queue = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    b.touched = (uint32_t*)xmalloc((size_t)n * 2 * sizeof(uint32_t) + 1);
+    if (!b.even || !b.in_blossom || !b.dead || !b.lca_mark) { fprintf(stderr, "OOM\n"); exit(1); }
+    b.lca_stamp = 0;
+    for (uint32_t v = 0; v < n; v++) {
+        b.parent[v] = -1;
+        b.base[v] = v;
+    }
+
+    double deadline = now_seconds() + budget_s;
+    int augmented = 0;
+    *timed_out = 0;
+    for (uint32_t v = 0; v < n; v++) {
+        if (match[v] != -1 || b.dead[v] || g->offs[v] == g->offs[v + 1]) continue;
+        if (now_seconds() > deadline) { *timed_out = 1; break; }
+        if (blossom_augment_from(&b, v)) {
+            augmented++;
+            if (progress) progress(progress_arg, match, augmented);
+        }
+    }
+
+    free(b.parent);
+    free(b.base);
+    free(b.even);
+    free(b.in_blossom);
+    free(b.dead);
+    free(b.lca_mark);
+    free(b.queue);
+    free(b.touched);
+    return augmented;
+}
+
+// Local improvement without the compatibility graph: length-3 augmenting
+// paths u - v = w - x, where u and x are free, v and w are paired, u fits
+// v and w fits x. Rematching u with v and w with x adds one pair. Partners
+// are taken from the fanout lists of shared nets (at most SWAP_MAX_FANOUT
+// per net), so this is cheap enough to run before the graph is built.
+#define SWAP_MAX_FANOUT 32
+
+static int improve_swaps(const Lut *luts, int n_luts, const FanoutIndex *fx, int32_t *match,
+                         double deadline, MatchProgressFn progress, void *progress_arg) {
+    int augmented = 0;
+    for (int u = 0; u < n_luts; u++) {
+        if ((u & 255) == 0 && now_seconds() > deadline) break;
+        const Lut *a = &luts[u];
+        if (match[u] != -1 || a->n > LUT_MAX_INPUTS) continue;
+        int done = 0;
+        for (int k = 0; k < a->n && !done; k++) {
+            uint32_t id = a->in[k];
+            uint32_t lo = fx->offs[id], hi = fx->offs[id + 1];
+            if (hi - lo > SWAP_MAX_FANOUT) hi = lo + SWAP_MAX_FANOUT;
+            for (uint32_t c = lo; c < hi && !done; c++) {
+                uint32_t v = fx->luts[c];
+                int32_t w = match[v];
+                if ((int)v == u || w < 0 || !union_unique_count_le6(a, &luts[v])) continue;
+                const Lut *lw = &luts[w];
+                for (int q = 0; q < lw->n && !done; q++) {
+                    uint32_t wid = lw->in[q];
+                    uint32_t lo2 = fx->offs[wid], hi2 = fx->offs[wid + 1];
+                    if (hi2 - lo2 > SWAP_MAX_FANOUT) hi2 = lo2 + SWAP_MAX_FANOUT;
+                    for (uint32_t c2 = lo2; c2 < hi2; c2++) {
+                        uint32_t x = fx->luts[c2];
+                        if ((int)x == u || match[x] != -1 || (int32_t)x == w) continue;
+                        if (!union_unique_count_le6(lw, &luts[x])) continue;
+                        match[u] = (int32_t)v;
+                        match[v] = u;
+                        match[w] = (int32_t)x;
+                        match[x] = w;
+                        done = 1;
+                        break;
+                    }
+                }
+            }
+        }
+        if (done) {
+            augmented++;
+            if (progress) progress(progress_arg, match, augmented);
+        }
+    }
+    return augmented;
+}
+
+// Pairing strategies. Each one pairs LUTs that are not yet used, writes the
+// pairs to ctx->pair_a/pair_b and returns how many it made; the caller
+// clears the `used` flags before each run. Strategies that work on the
+// compatibility graph finish with a first-fit pass, so every result is
+// maximal even though the graph only carries some of the free edges.
+typedef struct {
+    Lut *luts;
+    int n_luts;
+    const FanoutIndex *fx;
+    const CompatGraph *g;   // set when the strategy has needs_graph
+    const NetGraph *ng;     // set when the strategy has needs_netgraph
+    int *pair_a;
+    int *pair_b;
+    int threads;            // -j share of this testcase
+} PairCtx;
+
+typedef struct {
+    const char *name;
+    int needs_graph;
+    int needs_netgraph;
+    int (*run)(PairCtx *ctx);
+} PairStrategy;
+
+static int take_pair(PairCtx *c, int n_pairs, uint32_t i, uint32_t j) {
+    c->luts[i].used = 1;
+    c->luts[j].used = 1;
+    c->pair_a[n_pairs] = (int)i;
+    c->pair_b[n_pairs] = (int)j;
+    return n_pairs + 1;
+}
+
+static int finish_first_fit(PairCtx *c, int n_pairs) {
+    return n_pairs + pair_first_fit(c->luts, c->n_luts, c->fx,
+                                    c->pair_a + n_pairs, c->pair_b + n_pairs);
+}
+
+static int lut_shared_count(const Lut *a, const Lut *b) {
+    int i = 0, j = 0, common = 0;
+    while (i < a->n && j < b->n) {
+        uint32_t x = a->in[i], y = b->in[j];
+        common += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return common;
+}
+
+// Binary min-heap of 64-bit keys.
+typedef struct {
+    uint64_t *v;
+    size_t n;
+    size_t cap;
+} U64Heap;
+
+static void heap_push(U64Heap *h, uint64_t key) {
+    if (h->n == h->cap) {
+        h->cap = h->cap ? h->cap * 2 : 1024;
+        h->v = (uint64_t*)xrealloc(h->v, h->cap * sizeof(uint64_t));
+    }
+    size_t k = h->n++;
+    while (k > 0) {
+        size_t up = (k - 1) / 2;
+        if (h->v[up] <= key) break;
+        h->v[k] = h->v[up];
+        k = up;
+    }
+    h->v[k] = key;
+}
+
+static uint64_t heap_pop(U64Heap *h) {
+    uint64_t top = h->v[0];
+    uint64_t last = h->v[--h->n];
+    size_t k = 0;
+    for (;;) {
+        size_t c = 2 * k + 1;
+        if (c >= h->n) break;
+        if (c + 1 < h->n && h->v[c + 1] < h->v[c]) c++;
+        if (last <= h->v[c]) break;
+        h->v[k] = h->v[c];
+        k = c;
+    }
+    if (h->n) h->v[k] = last;
+    return top;
+}
+
+static int strategy_first_fit(PairCtx *c) {
+    return pair_first_fit(c->luts, c->n_luts, c->fx, c->pair_a, c->pair_b);
+}
+
+static int strategy_min_degree(PairCtx *c) {
+    // Most-constrained first: repeatedly take the unused LUT with the fewest
+    // unused neighbours and pair it with its lowest-degree neighbour. Degrees
+    // are kept exact with a lazy heap keyed by (degree, LUT).
+    const CompatGraph *g = c->g;
+    uint32_t n = g->n;
+    uint32_t *deg = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    U64Heap h = {0};
+    for (uint32_t v = 0; v < n; v++) {
+        deg[v] = g->offs[v + 1] - g->offs[v];
+        if (deg[v] && !c->luts[v].used) heap_push(&h, ((uint64_t)deg[v] << 32) | v);
+    }
+
+    int n_pairs = 0;
+    while (h.n) {
+        uint64_t key = heap_pop(&h);
+        uint32_t v = (uint32_t)key;
+        if (c->luts[v].used || (key >> 32) != deg[v]) continue;
+        uint32_t best = UINT32_MAX;
+        for (GraphRow r = graph_row(g, v); graph_next(&r); ) {
+            uint32_t u = r.u;
+            if (c->luts[u].used) continue;
+            if (best == UINT32_MAX || deg[u] < deg[best] || (deg[u] == deg[best] && u < best)) best = u;
+        }
+        if (best == UINT32_MAX) continue;
+        n_pairs = take_pair(c, n_pairs, v, best);
+        uint32_t ends[2] = { v, best };
+        for (int e = 0; e < 2; e++) {
+            for (GraphRow r = graph_row(g, ends[e]); graph_next(&r); ) {
+                uint32_t w = r.u;
+                if (c->luts[w].used) continue;
+                deg[w]--;
+                if (deg[w]) heap_push(&h, ((uint64_t)deg[w] << 32) | w);
+            }
+        }
+    }
+    free(h.v);
+    free(deg);
+    return finish_first_fit(c, n_pairs);
+}
+
+static int strategy_max_shared(PairCtx *c) {
+    // Edges in order of decreasing shared-input count (stable by LUT ID):
+    // merges that share the most nets go first.
+    const CompatGraph *g = c->g;
+    uint32_t n = g->n;
+    size_t count[LUT_MAX_INPUTS + 2] = {0};
+    for (uint32_t u = 0; u < n; u++) {
+        for (GraphRow r = graph_row(g, u); graph_next(&r); ) {
+            uint32_t v = r.u;
+            if (v > u) count[LUT_MAX_INPUTS - lut_shared_count(&c->luts[u], &c->luts[v]) + 1]++;
+        }
+    }
+    for (int w = 0; w <= LUT_MAX_INPUTS; w++) count[w + 1] += count[w];
+    uint32_t *uv = (uint32_t*)xmalloc(count[LUT_MAX_INPUTS + 1] * 2 * sizeof(uint32_t) + 1);
+    for (uint32_t u = 0; u < n; u++) {
+        for (GraphRow r = graph_row(g, u); graph_next(&r); ) {
+            uint32_t v = r.u;
+            if (v <= u) continue;
+            size_t slot = count[LUT_MAX_INPUTS - lut_shared_count(&c->luts[u], &c->luts[v])]++;
+            uv[2 * slot] = u;
+            uv[2 * slot + 1] = v;
+        }
+    }
+
+    int n_pairs = 0;
+    for (size_t e = 0; e < count[LUT_MAX_INPUTS]; e++) {
+        uint32_t u = uv[2 * e], v = uv[2 * e + 1];
+        if (!c->luts[u].used && !c->luts[v].used) n_pairs = take_pair(c, n_pairs, u, v);
+    }
+    free(uv);
+    return finish_first_fit(c, n_pairs);
+}
+
+static int strategy_bucketed(PairCtx *c) {
+    // Widest LUTs first, each taking the widest partner that fits: a LUT6 can
+    // only absorb a partner whose inputs are a subset of its own, so it gets
+    // first pick, and small LUTs are saved for whoever is left. A LUT with no
+    // partner when its turn comes is retired; without --preserve-depth it can
+    // never get one later, but the depth scan gives up after DEPTH_SCAN_LIMIT
+    // incompatible LUTs, so first-fit gets the leftovers. Like the bucket
+    // cursors, net_cur only moves forward past LUTs that are done.
+    Lut *luts = c->luts;
+    int n_luts = c->n_luts;
+    const FanoutIndex *fx = c->fx;
+    SizeBuckets sb;
+    build_size_buckets(luts, n_luts, &sb);
+    uint32_t cur[LUT_MAX_INPUTS + 1];
+    memcpy(cur, sb.start, sizeof(cur));
+    uint32_t *net_cur = (uint32_t*)xmalloc(((size_t)fx->n_nets + 1) * sizeof(uint32_t));
+    memcpy(net_cur, fx->offs, (size_t)fx->n_nets * sizeof(uint32_t));
+    uint8_t *done = (uint8_t*)xmalloc((size_t)n_luts + 1);
+    for (int v = 0; v < n_luts; v++) done[v] = luts[v].used || luts[v].n > LUT_MAX_INPUTS;
+
+    int n_pairs = 0;
+    for (int s = LUT_MAX_INPUTS; s >= 0; s--) {
+        for (uint32_t p = sb.start[s]; p < sb.start[s + 1]; p++) {
+            uint32_t i = sb.ids[p];
+            if (done[i]) continue;
+            done[i] = 1;
+            const Lut *a = &luts[i];
+            uint32_t best = UINT32_MAX;
+            int best_n = -1;
+
+            for (int k = 0; k < a->n; k++) {
+                uint32_t id = a->in[k];
+                uint32_t q = net_cur[id], e = fx->offs[id + 1];
+                while (q < e && done[fx->luts[q]]) q++;
+                net_cur[id] = q;
+                for (; q < e; q++) {
+                    uint32_t j = fx->luts[q];
+                    int nj = luts[j].n;
+                    if (done[j] || nj < best_n || (nj == best_n && j > best)) continue;
+                    if (union_unique_count_le6(a, &luts[j])) { best = j; best_n = nj; }
+                }
+            }
+            for (int t = LUT_MAX_INPUTS - a->n; t >= 0 && t >= best_n; t--) {
+                uint32_t q = cur[t], e = sb.start[t + 1];
+                while (q < e && done[sb.ids[q]]) q++;
+                cur[t] = q;
+                if (a->leveled) {
+                    uint32_t lim = e - q > DEPTH_SCAN_LIMIT ? q + DEPTH_SCAN_LIMIT : e;
+                    while (q < lim && (done[sb.ids[q]] || !depth_compatible(a, &luts[sb.ids[q]]))) q++;
+                    if (q == lim) continue;
+                }
+                if (q == e) continue;
+                uint32_t j = sb.ids[q];
+                if (t > best_n || j < best) { best = j; best_n = t; }
+                break;
+            }
+
+            if (best != UINT32_MAX) {
+                done[best] = 1;
+                n_pairs = take_pair(c, n_pairs, i, best);
+            }
+        }
+    }
+    free(done);
+    free(net_cur);
+    free_size_buckets(&sb);
+    return finish_first_fit(c, n_pairs);
+}
+
+static int rows_intersect(const uint32_t *a, uint32_t na, const uint32_t *b, uint32_t nb) {
+    uint32_t i = 0, j = 0;
+    while (i < na && j < nb) {
+        if (a[i] == b[j]) return 1;
+        if (a[i] < b[j]) i++;
+        else j++;
+    }
+    return 0;
+}
+
+#define CONE_MAX_FANOUT 32  // sinks per output net examined for a common sink
+#define CONE_MAX_SCORE  (LUT_MAX_INPUTS + 3)
+
+static int strategy_cone(PairCtx *c) {
+    // Topological locality first: edges in order of decreasing closeness
+    // (stable by LUT ID), where closeness is the shared-input count, plus 2
+    // when one LUT drives the other and 1 when their outputs feed a common
+    // cell. Merged pairs then stay inside one logic cone instead of joining
+    // unrelated LUTs that happen to fit.
+    const CompatGraph *g = c->g;
+    const NetGraph *ng = c->ng;
+    uint32_t n = g->n;
+    uint8_t *score = (uint8_t*)xmalloc((size_t)g->offs[n] + 1);
+    uint32_t *stamp = (uint32_t*)calloc((size_t)ng->n_cells + 1, sizeof(uint32_t));
+    if (!stamp) { fprintf(stderr, "OOM\n"); exit(1); }
+    size_t count[CONE_MAX_SCORE + 2] = {0};
+
+    for (uint32_t u = 0; u < n; u++) {
+        const uint32_t *u_out = ng->out + ng->out_offs[u];
+        uint32_t u_nout = ng->out_offs[u + 1] - ng->out_offs[u];
+        const uint32_t *u_in = ng->in + ng->in_offs[u];
+        uint32_t u_nin = ng->in_offs[u + 1] - ng->in_offs[u];
+        for (uint32_t o = 0; o < u_nout; o++) {
+            uint32_t lo = ng->sink_offs[u_out[o]], hi = ng->sink_offs[u_out[o] + 1];
+            if (hi - lo > CONE_MAX_FANOUT) hi = lo + CONE_MAX_FANOUT;
+            for (uint32_t k = lo; k < hi; k++) stamp[ng->sink[k]] = u + 1;
+        }
+        for (GraphRow r = graph_row(g, u); graph_next(&r); ) {
+            uint32_t v = r.u, k = r.k - 1;
+            if (v <= u) continue;
+            const uint32_t *v_out = ng->out + ng->out_offs[v];
+            uint32_t v_nout = ng->out_offs[v + 1] - ng->out_offs[v];
+            const uint32_t *v_in = ng->in + ng->in_offs[v];
+            uint32_t v_nin = ng->in_offs[v + 1] - ng->in_offs[v];
+            int sc = lut_shared_count(&c->luts[u], &c->luts[v]);
+            if (rows_intersect(u_out, u_nout, v_in, v_nin) || rows_intersect(v_out, v_nout, u_in, u_nin)) sc += 2;
+            int common = 0;
+            for (uint32_t o = 0; o < v_nout && !common; o++) {
+                uint32_t lo = ng->sink_offs[v_out[o]], hi = ng->sink_offs[v_out[o] + 1];
+                if (hi - lo > CONE_MAX_FANOUT) hi = lo + CONE_MAX_FANOUT;
+                for (uint32_t q = lo; q < hi; q++) {
+                    if (stamp[ng->sink[q]] == u + 1) { common = 1; break; }
+                }
+            }
+            sc += common;
+            score[k] = (uint8_t)sc;
+            count[CONE_MAX_SCORE - sc + 1]++;
+        }
+    }
+    free(stamp);
+
+    for (int w = 0; w <= CONE_MAX_SCORE; w++) count[w + 1] += count[w];
+    uint32_t *uv = (uint32_t*)xmalloc(count[CONE_MAX_SCORE + 1] * 2 * sizeof(uint32_t) + 1);
+    for (uint32_t u = 0; u < n; u++) {
+        for (GraphRow r = graph_row(g, u); graph_next(&r); ) {
+            uint32_t v = r.u;
+            if (v <= u) continue;
+            size_t slot = count[CONE_MAX_SCORE - score[r.k - 1]]++;
+            uv[2 * slot] = u;
+            uv[2 * slot + 1] = v;
+        }
+    }
+    free(score);
+
+    int n_pairs = 0;
+    for (size_t e = 0; e < count[CONE_MAX_SCORE]; e++) {
+        uint32_t u = uv[2 * e], v = uv[2 * e + 1];
+        if (!c->luts[u].used && !c->luts[v].used) n_pairs = take_pair(c, n_pairs, u, v);
+    }
+    free(uv);
+    return finish_first_fit(c, n_pairs);
+}
+
+// Identical input sets first: two LUTs reading exactly the same nets always
+// fit one LUT6D, so LUTs are bucketed by a hash of their sorted input set
+// and each bucket is paired off in LUT order, with no union tests at all.
+// First-fit then pairs the rest.
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int strategy_identical(PairCtx *c) {
+    Lut *luts = c->luts;
+    int n = c->n_luts;
+    uint64_t *keys = (uint64_t*)xmalloc((size_t)n * sizeof(uint64_t) + 1);
+    int n_keys = 0;
+    for (int i = 0; i < n; i++) {
+        const Lut *l = &luts[i];
+        if (l->used || l->n == 0 || l->n > LUT_MAX_INPUTS) continue;
+        uint32_t h = hash_bytes((const char*)l->in, (size_t)l->n * sizeof(uint32_t));
+        keys[n_keys++] = (uint64_t)h << 32 | (uint32_t)i;
+    }
+    qsort(keys, (size_t)n_keys, sizeof(uint64_t), compare_u64);
+
+    int n_pairs = 0;
+    for (int lo = 0, hi; lo < n_keys; lo = hi) {
+        for (hi = lo + 1; hi < n_keys && keys[hi] >> 32 == keys[lo] >> 32; hi++) {}
+        // A bucket may mix sets whose hashes collide; match exact sets only.
+        for (int x = lo; x < hi; x++) {
+            Lut *a = &luts[(uint32_t)keys[x]];
+            if (a->used) continue;
+            for (int y = x + 1; y < hi; y++) {
+                Lut *b = &luts[(uint32_t)keys[y]];
+                if (b->used || b->n != a->n || memcmp(a->in, b->in, (size_t)a->n * sizeof(uint32_t)) != 0) continue;
+                if (a->leveled && !depth_compatible(a, b)) continue;
+                n_pairs = take_pair(c, n_pairs, (uint32_t)keys[x], (uint32_t)keys[y]);
+                break;
+            }
+        }
+    }
+    free(keys);
+    return finish_first_fit(c, n_pairs);
+}
+
+// Subsets first: a 6-input LUT can only absorb a partner whose inputs all
+// lie inside its own six, so instead of testing candidates pairwise each
+// free LUT6 enumerates the proper subsets of its inputs (at most 62, the
+// largest first so wide partners go before the LUT2/LUT3s that fit almost
+// anywhere) and looks each one up among the smaller LUTs, keyed by the
+// same sorted-input-set hash as the identical strategy. The subset inputs
+// come out sorted because the LUT's inputs are, so a hash hit is confirmed
+// with one memcmp. The set hash is a sum of mixed net IDs, so the 62
+// subset hashes of a LUT6 cost one add each; bucket heads sit in an
+// open-addressing table, so each lookup is about one probe. First-fit then
+// pairs the rest.
+static inline uint64_t net_mix(uint32_t id) {
+    // splitmix64 finalizer
+    uint64_t z = (uint64_t)id + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static int strategy_subset(PairCtx *c) {
+    Lut *luts = c->luts;
+    int n = c->n_luts;
+    uint64_t *keys = (uint64_t*)xmalloc((size_t)n * sizeof(uint64_t) + 1);
+    int n_keys = 0, have_size[LUT_MAX_INPUTS] = {0};
+    for (int i = 0; i < n; i++) {
+        const Lut *l = &luts[i];
+        if (l->used || l->n == 0 || l->n >= LUT_MAX_INPUTS) continue;
+        have_size[l->n] = 1;
+        uint64_t sum = 0;
+        for (int k = 0; k < l->n; k++) sum += net_mix(l->in[k]);
+        uint32_t h = (uint32_t)(sum >> 32);
+        keys[n_keys++] = (uint64_t)h << 32 | (uint32_t)i;
+    }
+    qsort(keys, (size_t)n_keys, sizeof(uint64_t), compare_u64);
+    // head[] maps a hash to its bucket's first free entry: nothing before it
+    // in the bucket is free, so taken LUTs are skipped once, not per lookup.
+    uint32_t cap = 16;
+    while (cap < 2u * (uint32_t)n_keys) cap <<= 1;
+    // Each slot holds hash << 32 | first free entry; empty slots are ~0.
+    uint64_t *head = (uint64_t*)xmalloc((size_t)cap * sizeof(uint64_t));
+    for (uint32_t k = 0; k < cap; k++) head[k] = UINT64_MAX;
+    for (int x = 0; x < n_keys; x++) {
+        if (x > 0 && keys[x] >> 32 == keys[x - 1] >> 32) continue;
+        uint32_t k = (uint32_t)(keys[x] >> 32) & (cap - 1);
+        while (head[k] != UINT64_MAX) k = (k + 1) & (cap - 1);
+        head[k] = (keys[x] >> 32) << 32 | (uint32_t)x;
+    }
+
+    // Subset masks of six inputs, by decreasing popcount; 0 and 63 excluded,
+    // as are sizes no free LUT has.
+    int masks[62], n_masks = 0;
+    for (int k = LUT_MAX_INPUTS - 1; k >= 1; k--)
+        for (int m = 1; m < 63 && have_size[k]; m++)
+            if (popcount64((uint64_t)m) == k) masks[n_masks++] = m;
+
+    int n_pairs = 0;
+    for (int i = 0; i < n && n_keys > 0; i++) {
+        Lut *a = &luts[i];
+        if (a->used || a->n != LUT_MAX_INPUTS) continue;
+        uint64_t sums[64];
+        sums[0] = 0;
+        for (int m = 1; m < 64; m++) sums[m] = sums[m & (m - 1)] + net_mix(a->in[__builtin_ctz((unsigned)m)]);
+        for (int q = 0; q < n_masks; q++) {
+            uint32_t h = (uint32_t)(sums[masks[q]] >> 32);
+            uint32_t k = h & (cap - 1);
+            while (head[k] != UINT64_MAX && head[k] >> 32 != h) k = (k + 1) & (cap - 1);
+            if (head[k] == UINT64_MAX) continue;
+            uint32_t sub[LUT_MAX_INPUTS];
+            int ns = 0;
+            for (int b = 0; b < LUT_MAX_INPUTS; b++)
+                if (masks[q] >> b & 1) sub[ns++] = a->in[b];
+            int x = (int)(uint32_t)head[k], found = -1;
+            while (x < n_keys && keys[x] >> 32 == h && luts[(uint32_t)keys[x]].used) x++;
+            head[k] = (uint64_t)h << 32 | (uint32_t)x;
+            for (; x < n_keys && keys[x] >> 32 == h; x++) {
+                uint32_t j = (uint32_t)keys[x];
+                const Lut *b = &luts[j];
+                if (b->used || b->n != ns || memcmp(b->in, sub, (size_t)ns * sizeof(uint32_t)) != 0) continue;
+                if (a->leveled && !depth_compatible(a, b)) continue;
+                found = (int)j;
+                break;
+            }
+            if (found >= 0) {
+                n_pairs = take_pair(c, n_pairs, (uint32_t)i, (uint32_t)found);
+                break;
+            }
+        }
+    }
+    free(keys);
+    free(head);
+    return finish_first_fit(c, n_pairs);
+}
+
+// Partitioned first-fit. Union-find over the fanout index joins LUTs that
+// share a net, except through nets read by more than PART_MAX_FANOUT LUTs
+// (a reset or enable would glue the design into one blob). Components
+// larger than PART_MAX_LUTS are cut into balanced pieces along BFS order,
+// which keeps neighbouring LUTs together. Each piece is copied out with its
+// LUTs and nets renumbered contiguously and paired by first-fit on its own,
+// biggest pieces first, pulled by the workers from a shared counter. A
+// global first-fit pass over the LUTs left free then picks up the pairs
+// across pieces: wide nets, cut edges and non-sharing pairs. The result does
+// not depend on the thread count.
+#define PART_MAX_FANOUT 64
+#define PART_MAX_LUTS   4096
+
+typedef struct {
+    const Lut *luts;
+    const FanoutIndex *fx;
+    const uint32_t *members;    // LUT IDs, piece by piece
+    const uint32_t *start;      // piece p is members[start[p] .. start[p + 1])
+    const uint32_t *order;      // pieces, largest first
+    uint32_t n_parts;
+    uint32_t next;
+    int *pair_a, *pair_b;       // piece p writes from start[p] / 2 on
+    uint32_t *n_pairs;          // per piece
+} PartitionRun;
+
+static uint32_t uf_find(uint32_t *parent, uint32_t v) {
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+static void partition_worker(void *arg, int tid, int n_threads) {
+    (void)tid;
+    (void)n_threads;
+    PartitionRun *pr = (PartitionRun*)arg;
+    uint32_t n_nets = pr->fx->n_nets;
+    uint32_t *net_map = (uint32_t*)xmalloc((size_t)n_nets * sizeof(uint32_t) + 1);
+    for (uint32_t id = 0; id < n_nets; id++) net_map[id] = NET_ID_PAD;
+    Lut *local = (Lut*)xmalloc((size_t)PART_MAX_LUTS * sizeof(Lut));
+    uint32_t *nets = (uint32_t*)xmalloc((size_t)PART_MAX_LUTS * LUT_MAX_INPUTS * sizeof(uint32_t));
+    int *la = (int*)xmalloc((size_t)PART_MAX_LUTS * sizeof(int));
+    int *lb = (int*)xmalloc((size_t)PART_MAX_LUTS * sizeof(int));
+    for (;;) {
+        uint32_t k = atomic_add_u32(&pr->next, 1);
+        if (k >= pr->n_parts) break;
+        uint32_t p = pr->order[k];
+        const uint32_t *mem = pr->members + pr->start[p];
+        int m = (int)(pr->start[p + 1] - pr->start[p]);
+        uint32_t n_local = 0;
+        for (int i = 0; i < m; i++) {
+            Lut *l = &local[i];
+            *l = pr->luts[mem[i]];
+            for (int q = 0; q < l->n; q++) {
+                uint32_t id = l->in[q];
+                if (net_map[id] == NET_ID_PAD) {
+                    net_map[id] = n_local;
+                    nets[n_local++] = id;
+                }
+                l->in[q] = net_map[id];
+            }
+            lut_sort_inputs(l);
+        }
+        FanoutIndex fx;
+        build_fanout_index_of(local, m, n_local, &fx);
+        int np = pair_first_fit(local, m, &fx, la, lb);
+        free_fanout_index(&fx);
+        for (uint32_t q = 0; q < n_local; q++) net_map[nets[q]] = NET_ID_PAD;
+        int *out_a = pr->pair_a + pr->start[p] / 2, *out_b = pr->pair_b + pr->start[p] / 2;
+        for (int q = 0; q < np; q++) {
+            out_a[q] = (int)mem[la[q]];
+            out_b[q] = (int)mem[lb[q]];
+        }
+        pr->n_pairs[p] = (uint32_t)np;
+    }
+    free(net_map);
+    free(local);
+    free(nets);
+    free(la);
+    free(lb);
+}
+
+static int strategy_partitioned(PairCtx *c) {
+    Lut *luts = c->luts;
+    const FanoutIndex *fx = c->fx;
+    uint32_t n = (uint32_t)c->n_luts;
+    if (n == 0) return 0;
+
+    // Components of the sharing graph; roots are the smallest member.
+    uint32_t *parent = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t));
+    for (uint32_t v = 0; v < n; v++) parent[v] = v;
+    for (uint32_t id = 0; id < fx->n_nets; id++) {
+        uint32_t lo = fx->offs[id], hi = fx->offs[id + 1];
+        if (hi - lo < 2 || hi - lo > PART_MAX_FANOUT) continue;
+        uint32_t r = uf_find(parent, fx->luts[lo]);
+        for (uint32_t q = lo + 1; q < hi; q++) {
+            uint32_t s = uf_find(parent, fx->luts[q]);
+            if (s == r) continue;
+            if (s < r) { uint32_t t = r; r = s; s = t; }
+            parent[s] = r;
+        }
+    }
+
+    // Lay members out component by component (BFS from the root, which
+    // orders big components for cutting), skipping LUTs already used.
+    uint32_t *comp_size = (uint32_t*)calloc((size_t)n + 1, sizeof(uint32_t));
+    if (!comp_size) { fprintf(stderr, "OOM\n"); exit(1); }
+    for (uint32_t v = 0; v < n; v++) {
+        parent[v] = uf_find(parent, v);
+        if (!luts[v].used && luts[v].n <= LUT_MAX_INPUTS) comp_size[parent[v]]++;
+    }
+    uint32_t *members = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    uint8_t *seen = (uint8_t*)calloc((size_t)n + 1, 1);
+    uint32_t *start = (uint32_t*)xmalloc(((size_t)n + 2) * sizeof(uint32_t));
+    if (!seen) { fprintf(stderr, "OOM\n"); exit(1); }
+    uint32_t n_mem = 0, n_parts = 0;
+    for (uint32_t root = 0; root < n; root++) {
+        if (parent[root] != root || comp_size[root] < 2) continue;
+        uint32_t head = n_mem;
+        uint32_t pieces = (comp_size[root] + PART_MAX_LUTS - 1) / PART_MAX_LUTS;
+        uint32_t per = (comp_size[root] + pieces - 1) / pieces;
+        // BFS over shared nets; the root is the smallest member, so every
+        // member is reached from it through nets of bounded fanout.
+        uint32_t qh = n_mem, first = root;
+        while (n_mem - head < comp_size[root]) {
+            while (first < n && (parent[first] != root || seen[first] || luts[first].used ||
+                                 luts[first].n > LUT_MAX_INPUTS)) first++;
+            if (qh == n_mem) { // reachable part exhausted (used LUTs cut it)
+                seen[first] = 1;
+                members[n_mem++] = first;
+            }
+            for (; qh < n_mem; qh++) {
+                const Lut *a = &luts[members[qh]];
+                for (int k = 0; k < a->n; k++) {
+                    uint32_t lo = fx->offs[a->in[k]], hi = fx->offs[a->in[k] + 1];
+                    if (hi - lo > PART_MAX_FANOUT) continue;
+                    for (uint32_t q = lo; q < hi; q++) {
+                        uint32_t v = fx->luts[q];
+                        if (seen[v] || luts[v].used) continue;
+                        seen[v] = 1;
+                        members[n_mem++] = v;
+                    }
+                }
+            }
+        }
+        for (uint32_t at = head; at < n_mem; at += per) start[n_parts++] = at;
+    }
+    start[n_parts] = n_mem;
+
+    uint32_t *order = (uint32_t*)xmalloc((size_t)n_parts * sizeof(uint32_t) + 1);
+    uint32_t *n_pairs = (uint32_t*)calloc((size_t)n_parts + 1, sizeof(uint32_t));
+    if (!n_pairs) { fprintf(stderr, "OOM\n"); exit(1); }
+    for (uint32_t p = 0; p < n_parts; p++) order[p] = p;
+    // Largest first; insertion into a counting order keeps this O(n).
+    {
+        uint32_t *cnt = (uint32_t*)calloc(PART_MAX_LUTS + 2, sizeof(uint32_t));
+        if (!cnt) { fprintf(stderr, "OOM\n"); exit(1); }
+        for (uint32_t p = 0; p < n_parts; p++) cnt[PART_MAX_LUTS - (start[p + 1] - start[p]) + 1]++;
+        for (uint32_t s = 1; s <= PART_MAX_LUTS + 1; s++) cnt[s] += cnt[s - 1];
+        for (uint32_t p = 0; p < n_parts; p++) order[cnt[PART_MAX_LUTS - (start[p + 1] - start[p])]++] = p;
+        free(cnt);
+    }
+
+    int *tmp_a = (int*)xmalloc(((size_t)n / 2 + 1) * sizeof(int));
+    int *tmp_b = (int*)xmalloc(((size_t)n / 2 + 1) * sizeof(int));
+    PartitionRun pr = { luts, fx, members, start, order, n_parts, 0, tmp_a, tmp_b, n_pairs };
+    int workers = c->threads < (int)n_parts ? c->threads : (int)n_parts;
+    parallel_run(workers < 1 ? 1 : workers, partition_worker, &pr);
+
+    // Stitch in piece order, then pair across pieces.
+    int total = 0;
+    for (uint32_t p = 0; p < n_parts; p++) {
+        for (uint32_t q = 0; q < n_pairs[p]; q++) {
+            total = take_pair(c, total, (uint32_t)tmp_a[start[p] / 2 + q], (uint32_t)tmp_b[start[p] / 2 + q]);
+        }
+    }
+    free(parent);
+    free(comp_size);
+    free(members);
+    free(seen);
+    free(start);
+    free(order);
+    free(n_pairs);
+    free(tmp_a);
+    free(tmp_b);
+    return finish_first_fit(c, total);
+}
+
+// Parallel greedy on the compatibility graph, in Luby-style rounds. Every
+// edge has a fixed priority: its shared-input count (as in max-shared),
+// then a pseudo-random permutation of the edges. In each round every live
+// LUT proposes its best free neighbour and raises the offer slot of both
+// endpoints to that priority with a CAS loop. An edge whose priority ends
+// up in both slots is the best one offered at either end, and its proposer
+// claims the two `used` flags with CAS. Priorities are distinct, offers are
+// a maximum and claims never overlap, so the matching depends only on the
+// graph, not on the thread count or the schedule. A LUT rescans its row
+// only when its proposal was taken; LUTs left without a free neighbour
+// drop out, the rest go to the next round.
+#define LUBY_NONE UINT32_MAX
+#define LUBY_SCAN (UINT32_MAX - 1)
+#define LUBY_MASK ((1ull << 60) - 1)
+
+typedef struct {
+    const CompatGraph *g;
+    Lut *luts;
+    const uint32_t *active;
+    uint32_t n_active;
+    uint32_t next;          // chunk counter, reset before each phase
+    uint32_t *prop;         // proposed partner, LUBY_SCAN, or LUBY_NONE
+    uint64_t *prop_pri;     // priority of the edge to prop
+    uint64_t *offer;        // best priority offered to each LUT this round
+    uint32_t *mate;
+} LubyRun;
+
+static uint64_t luby_priority(const Lut *luts, uint32_t u, uint32_t v) {
+    // (min, max) packed into 60 bits (n_luts < 2^30) and mixed by steps
+    // that are each invertible mod 2^60, so distinct edges never tie.
+    uint64_t z = u < v ? ((uint64_t)u << 30) | v : ((uint64_t)v << 30) | u;
+    z = ((z ^ (z >> 29)) * 0xbf58476d1ce4e5b9ull) & LUBY_MASK;
+    z = ((z ^ (z >> 31)) * 0x94d049bb133111ebull) & LUBY_MASK;
+    z ^= z >> 29;
+    return ((uint64_t)lut_shared_count(&luts[u], &luts[v]) << 60) | z;
+}
+
+static void atomic_max_u64(uint64_t *p, uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    uint64_t old = __atomic_load_n(p, __ATOMIC_RELAXED);
+    while (v > old && !__atomic_compare_exchange_n(p, &old, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+#else
+    if (v > *p) *p = v; // single-threaded builds only
+#endif
+}
+
+static int claim_used(uint8_t *used) {
+#if defined(__GNUC__) || defined(__clang__)
+    uint8_t expect = 0;
+    return __atomic_compare_exchange_n(used, &expect, 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+#else
+    if (*used) return 0;
+    *used = 1;
+    return 1;
+#endif
+}
+
+static void luby_propose(void *arg, int tid, int n_threads) {
+    (void)tid;
+    (void)n_threads;
+    LubyRun *lr = (LubyRun*)arg;
+    const CompatGraph *g = lr->g;
+    const Lut *luts = lr->luts;
+    for (;;) {
+        uint32_t lo = atomic_add_u32(&lr->next, GRAPH_CHUNK);
+        if (lo >= lr->n_active) break;
+        uint32_t hi = lo + GRAPH_CHUNK < lr->n_active ? lo + GRAPH_CHUNK : lr->n_active;
+        for (uint32_t q = lo; q < hi; q++) {
+            uint32_t v = lr->active[q], best = lr->prop[v];
+            uint64_t best_pri = lr->prop_pri[v];
+            if (best == LUBY_SCAN || luts[best].used) {
+                best = LUBY_NONE;
+                for (GraphRow r = graph_row(g, v); graph_next(&r); ) {
+                    uint32_t u = r.u;
+                    if (luts[u].used) continue;
+                    uint64_t pri = luby_priority(luts, v, u);
+                    if (best == LUBY_NONE || pri > best_pri) {
+                        best = u;
+                        best_pri = pri;
+                    }
+                }
+                lr->prop[v] = best;
+                lr->prop_pri[v] = best_pri;
+                if (best == LUBY_NONE) continue;
+            }
+            atomic_max_u64(&lr->offer[v], best_pri);
+            atomic_max_u64(&lr->offer[best], best_pri);
+        }
+    }
+}
+
+static void luby_claim(void *arg, int tid, int n_threads) {
+    (void)tid;
+    (void)n_threads;
+    LubyRun *lr = (LubyRun*)arg;
+    for (;;) {
+        uint32_t lo = atomic_add_u32(&lr->next, GRAPH_CHUNK);
+        if (lo >= lr->n_active) break;
+        uint32_t hi = lo + GRAPH_CHUNK < lr->n_active ? lo + GRAPH_CHUNK : lr->n_active;
+        for (uint32_t q = lo; q < hi; q++) {
+            uint32_t v = lr->active[q], u = lr->prop[v];
+            if (u == LUBY_NONE) continue;
+            uint64_t pri = lr->prop_pri[v];
+            if (lr->offer[v] != pri || lr->offer[u] != pri) continue;
+            if (lr->prop[u] == v && u < v) continue; // mutual proposal: the smaller LUT claims
+            if (!claim_used(&lr->luts[v].used)) continue;
+            if (!claim_used(&lr->luts[u].used)) {
+                lr->luts[v].used = 0;
+                continue;
+            }
+            lr->mate[v] = u;
+            lr->mate[u] = v;
+        }
+    }
+}
+
+static int strategy_luby(PairCtx *c) {
+    const CompatGraph *g = c->g;
+    uint32_t n = g->n;
+    uint32_t *active = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    uint32_t *prop = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    uint32_t *mate = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t) + 1);
+    uint64_t *prop_pri = (uint64_t*)xmalloc((size_t)n * sizeof(uint64_t) + 1);
+    uint64_t *offer = (uint64_t*)calloc((size_t)n + 1, sizeof(uint64_t));
+    if (!offer) { fprintf(stderr, "OOM\n"); exit(1); }
+    uint32_t n_active = 0;
+    for (uint32_t v = 0; v < n; v++) {
+        mate[v] = LUBY_NONE;
+        prop[v] = LUBY_SCAN;
+        if (!c->luts[v].used && g->offs[v + 1] > g->offs[v]) active[n_active++] = v;
+    }
+
+    LubyRun lr = { g, c->luts, active, n_active, 0, prop, prop_pri, offer, mate };
+    int workers = c->threads < 1 ? 1 : c->threads;
+    while (lr.n_active) {
+        lr.next = 0;
+        parallel_run(workers, luby_propose, &lr);
+        lr.next = 0;
+        parallel_run(workers, luby_claim, &lr);
+        // Every free neighbour of a live LUT is live itself, so clearing the
+        // offers of the live LUTs clears every slot written this round.
+        uint32_t kept = 0;
+        for (uint32_t q = 0; q < lr.n_active; q++) {
+            uint32_t v = active[q];
+            offer[v] = 0;
+            if (!c->luts[v].used && prop[v] != LUBY_NONE) active[kept++] = v;
+        }
+        lr.n_active = kept;
+    }
+
+    int n_pairs = 0;
+    for (uint32_t v = 0; v < n; v++) {
+        if (mate[v] != LUBY_NONE && v < mate[v]) n_pairs = take_pair(c, n_pairs, v, mate[v]);
+    }
+    free(active);
+    free(prop);
+    free(mate);
+    free(prop_pri);
+    free(offer);
+    return finish_first_fit(c, n_pairs);
+}
+
+static const PairStrategy strategies[] = {
+    { "first-fit",  0, 0, strategy_first_fit },
+    { "min-degree", 1, 0, strategy_min_degree },
+    { "max-shared", 1, 0, strategy_max_shared },
+    { "bucketed",   0, 0, strategy_bucketed },
+    { "cone",       1, 1, strategy_cone },
+    { "partitioned", 0, 0, strategy_partitioned },
+    { "identical",  0, 0, strategy_identical },
+    { "subset",     0, 0, strategy_subset },
+    { "luby",       1, 0, strategy_luby },
+};
+#define N_STRATEGIES ((int)(sizeof(strategies) / sizeof(strategies[0])))
+
+int lutpair_find_strategy(const char *name) {
+    for (int k = 0; k < N_STRATEGIES; k++) {
+        if (strcmp(strategies[k].name, name) == 0) return k;
+    }
+    return -1;
+}
+
+static int ends_with(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    if (m > n) return 0;
+    return strcmp(s + (n - m), suffix) == 0;
+}
+
+static int match_design_v(const char *name, int *out_idx) {
+    // match design_<digits>.v or design_<digits>_syn.v exactly
+    if (!starts_with(name, "design_")) return 0;
+    if (!ends_with(name, ".v")) return 0;
+    const char *p = name + 7;
+    if (!isdigit((unsigned char)*p)) return 0;
+    int val = 0;
+    while (*p && *p != '.' && *p != '_') {
+        if (!isdigit((unsigned char)*p)) return 0;
+        val = val * 10 + (*p - '0');
+        p++;
+    }
+    if (strcmp(p, ".v") != 0 && strcmp(p, "_syn.v") != 0) return 0;
+    if (out_idx) *out_idx = val;
+    return 1;
+}
+
+// Growable text buffer (lutpair_log); run_one writes its report lines here
+// so concurrent testcases can be printed in order once they finish.
+typedef lutpair_log StrBuf;
+
+static void sb_printf(StrBuf *b, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        size_t room = b->cap - b->len;
+        int n = vsnprintf(b->s ? b->s + b->len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (n < 0) return;
+        if ((size_t)n < room) {
+            b->len += (size_t)n;
+            return;
+        }
+        size_t cap = b->cap ? b->cap : 256;
+        while (cap < b->len + (size_t)n + 1) cap *= 2;
+        b->s = (char*)xrealloc(b->s, cap);
+        b->cap = cap;
+    }
+}
+
+// --incremental: reuse the pairs of a previous run after a small netlist
+// edit. A previous pair is kept when both instances still exist, neither
+// is claimed twice, and their inputs still fit one LUT6D. Pairs that fail
+// mark their LUTs dirty, and so does every LUT the file does not pair: a
+// new instance looks the same there as one left single last time. A kept
+// pair is released when a member shares a net with a dirty LUT and could
+// take it as a partner (one hop in the fanout index, skipping nets wider
+// than INCR_MAX_FANOUT, which tie together half the design), so added and
+// edited LUTs are re-matched with their neighbourhood instead of only with
+// leftovers. Everything else is paired afresh. The .res holds no pins, so
+// an edited LUT whose old pair still fits keeps it.
+#define INCR_MAX_FANOUT 32
+typedef struct {
+    int prev;       // pairs in the previous file
+    int kept;
+    int invalid;    // missing instance, duplicate, or inputs no longer fit
+    int unpaired;   // LUTs the file does not pair: new, or single last time
+    int released;   // valid, but next to a changed or unpaired LUT that fits a member
+} IncrStats;
+
+static int load_prev_pairs(const char *path, const Lut *luts, int n_luts, const FanoutIndex *fx,
+                           int *pair_a, int *pair_b, IncrStats *st) {
+    // Writes the kept pairs to pair_a/pair_b and returns how many, or -1 if
+    // the file cannot be read.
+    memset(st, 0, sizeof(*st));
+    long len = 0;
+    char *buf = read_entire_file(path, &len);
+    if (!buf) return -1;
+
+    NetTable names;
+    net_table_init(&names);
+    int32_t *by_id = (int32_t*)xmalloc((size_t)n_luts * sizeof(int32_t) + 1);
+    for (int v = 0; v < n_luts; v++) {
+        uint32_t id = net_intern(&names, luts[v].inst, strlen(luts[v].inst));
+        if (id == names.count - 1) by_id[id] = v; // first of duplicate names wins
+    }
+    int32_t *partner = (int32_t*)xmalloc((size_t)n_luts * sizeof(int32_t) + 1);
+    uint8_t *dirty = (uint8_t*)calloc((size_t)n_luts + 1, 1);
+    if (!dirty) { fprintf(stderr, "OOM\n"); exit(1); }
+    for (int v = 0; v < n_luts; v++) partner[v] = -1;
+
+    // "<count>\n" then "<inst> <inst>\n" per pair; names never hold spaces.
+    const char *p = buf, *end = buf + len;
+    Token tok[2];
+    int have = 0, seen_count = 0;
+    while (p < end) {
+        while (p < end && isspace((unsigned char)*p)) p++;
+        if (p >= end) break;
+        const char *t = p;
+        while (p < end && !isspace((unsigned char)*p)) p++;
+        if (!seen_count) { seen_count = 1; continue; }
+        tok[have].s = t;
+        tok[have].len = (size_t)(p - t);
+        if (++have < 2) continue;
+        have = 0;
+        st->prev++;
+
+        int v[2];
+        for (int e = 0; e < 2; e++) {
+            uint32_t id = net_lookup(&names, tok[e].s, tok[e].len);
+            v[e] = id == NET_ID_PAD ? -1 : by_id[id];
+        }
+        int ok = v[0] >= 0 && v[1] >= 0 && v[0] != v[1] && partner[v[0]] < 0 && partner[v[1]] < 0 &&
+                 union_unique_count_le6(&luts[v[0]], &luts[v[1]]);
+        if (!ok) {
+            st->invalid++;
+            for (int e = 0; e < 2; e++) {
+                if (v[e] >= 0) dirty[v[e]] = 1;
+            }
+            continue;
+        }
+        partner[v[0]] = v[1];
+        partner[v[1]] = v[0];
+    }
+
+    for (int v = 0; v < n_luts; v++) {
+        if (partner[v] < 0 && !dirty[v]) st->unpaired++;
+        dirty[v] |= partner[v] < 0;
+    }
+    for (int d = 0; d < n_luts; d++) {
+        if (!dirty[d] || partner[d] >= 0) continue;
+        for (int k = 0; k < luts[d].n && k < LUT_MAX_INPUTS; k++) {
+            uint32_t id = luts[d].in[k];
+            if (fx->offs[id + 1] - fx->offs[id] > INCR_MAX_FANOUT) continue;
+            for (uint32_t q = fx->offs[id]; q < fx->offs[id + 1]; q++) {
+                int u = (int)fx->luts[q];
+                if (partner[u] < 0 || !union_unique_count_le6(&luts[d], &luts[u])) continue;
+                partner[partner[u]] = -1;
+                partner[u] = -1;
+                st->released++;
+            }
+        }
+    }
+
+    int n_kept = 0;
+    for (int v = 0; v < n_luts; v++) {
+        if (partner[v] > v) {
+            pair_a[n_kept] = v;
+            pair_b[n_kept] = partner[v];
+            n_kept++;
+        }
+    }
+    st->kept = n_kept;
+
+    free(dirty);
+    free(partner);
+    free(by_id);
+    net_table_free(&names);
+    free(buf);
+    return n_kept;
+}
+
+// Output files. Text is assembled in an OUT_BUF_SIZE buffer and written
+// with unbuffered fwrite; long runs (unchanged netlist text) bypass the
+// buffer and go out in one call, so copying a netlist through costs about
+// one memcpy.
+#define OUT_BUF_SIZE (1u << 20)
+
+typedef struct {
+    FILE *f;
+    char *buf;
+    size_t len;
+    int err;
+} OutBuf;
+
+static int out_open(OutBuf *o, const char *path) {
+    o->f = fopen(path, "wb");
+    if (!o->f) return 0;
+    setvbuf(o->f, NULL, _IONBF, 0);
+    o->buf = (char*)xmalloc(OUT_BUF_SIZE);
+    o->len = 0;
+    o->err = 0;
+    return 1;
+}
+
+static void out_flush(OutBuf *o) {
+    if (o->len && fwrite(o->buf, 1, o->len, o->f) != o->len) o->err = 1;
+    o->len = 0;
+}
+
+static void out_put(OutBuf *o, const char *p, size_t n) {
+    if (n > OUT_BUF_SIZE - o->len) {
+        out_flush(o);
+        if (n >= OUT_BUF_SIZE / 2) {
+            if (fwrite(p, 1, n, o->f) != n) o->err = 1;
+            return;
+        }
+    }
+    memcpy(o->buf + o->len, p, n);
+    o->len += n;
+}
+
+static void out_str(OutBuf *o, const char *s) {
+    out_put(o, s, strlen(s));
+}
+
+static void out_u64(OutBuf *o, uint64_t v) {
+    char d[20];
+    int k = (int)sizeof(d);
+    do { d[--k] = (char)('0' + v % 10); v /= 10; } while (v);
+    out_put(o, d + k, sizeof(d) - (size_t)k);
+}
+
+static int out_close(OutBuf *o) {
+    out_flush(o);
+    free(o->buf);
+    if (fclose(o->f) != 0) o->err = 1;
+    return !o->err;
+}
+
+static int write_res(const char *path, const Lut *luts, const int *pair_a, const int *pair_b, int n_pairs) {
+    // Written to a temporary and renamed, so a reader (or a job killed while
+    // --time-limit rewrites the file) always sees a complete result.
+    char tmp[1100];
+    temp_path_for(path, tmp, sizeof(tmp));
+    OutBuf o;
+    if (!out_open(&o, tmp)) return 0;
+    out_u64(&o, (uint64_t)n_pairs);
+    out_put(&o, "\n", 1);
+    for (int k = 0; k < n_pairs; k++) {
+        out_str(&o, luts[pair_a[k]].inst);
+        out_put(&o, " ", 1);
+        out_str(&o, luts[pair_b[k]].inst);
+        out_put(&o, "\n", 1);
+    }
+    if (!out_close(&o) || rename(tmp, path) != 0) {
+        remove(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+// --netlist: the source with every pair merged into one GTP_LUT6D. The
+// text is copied through unchanged except at paired instances: the Z-side
+// LUT's statement is replaced by the merged cell (keeping its instance
+// name) and the Z5-side LUT's line is dropped.
+//
+// GTP_LUT6D computes Z = INIT[I5..I0] and Z5 = INIT[31:0][I4..I0]. When the
+// union of inputs fits in five, I5 is tied to 1'b1 and INIT = {Z-side table,
+// Z5-side table}, which is exact. With six inputs, the Z5 side has to do
+// without one of them; that net goes on I5 and the low half holds the Z5
+// side's table, so Z is exact only when the Z side's I5 = 0 cofactor equals
+// it; if both LUTs read all six, Z5 cannot be exact either. Such merges
+// are counted in NetlistStats.inexact: the pairing rule (union of inputs
+// at most six) does not look at functions.
+typedef lutpair_netlist_stats NetlistStats;
+
+typedef struct {
+    const char *at, *end;   // source range replaced
+    int pair;               // index into the pair arrays, or -1 to drop the range
+} Splice;
+
+static int compare_splice(const void *a, const void *b) {
+    const char *x = ((const Splice*)a)->at, *y = ((const Splice*)b)->at;
+    return (x > y) - (x < y);
+}
+
+static uint64_t lut_table_on(const Lut *l, const LutPins *lp, const NetTable *nets, const uint32_t *slot) {
+    // l's function over the six LUT6D slots (slot[s] = net on I<s>). Pins
+    // outside the slots are constants or inputs pruned as irrelevant.
+    uint64_t init = l->init, t = 0;
+    if (lp->width < LUT_MAX_INPUTS) init &= (1ull << (1u << lp->width)) - 1;
+    for (uint32_t m = 0; m < 64; m++) {
+        uint32_t pat = 0;
+        for (int i = 0; i < lp->width; i++) {
+            uint32_t id = lp->net[i];
+            int bit = 0, s = 0;
+            uint64_t v;
+            while (s < LUT_MAX_INPUTS && slot[s] != id) s++;
+            if (id != NET_ID_PAD && s < LUT_MAX_INPUTS) bit = (int)((m >> s) & 1);
+            else if (id != NET_ID_PAD && net_is_const(nets->bytes + nets->offs[id], &v)) bit = (int)(v & 1);
+            pat |= (uint32_t)bit << i;
+        }
+        t |= ((init >> pat) & 1) << m;
+    }
+    return t;
+}
+
+static int lut6d_init(const Netlist *nl, int a, int b, uint32_t i5, uint32_t *slot, uint64_t *init) {
+    // Slots for a on Z and b on Z5 with net i5 on I5 (NET_ID_PAD: tied to
+    // 1'b1). Returns 1 when both outputs come out exact.
+    const Lut *luts = nl->luts;
+    int n_s = 0;
+    for (int s = 0; s < LUT_MAX_INPUTS; s++) slot[s] = NET_ID_PAD;
+    slot[5] = i5;
+    for (int k = 0; k < luts[a].n; k++) if (luts[a].in[k] != i5) slot[n_s++] = luts[a].in[k];
+    for (int k = 0; k < luts[b].n; k++) {
+        int dup = luts[b].in[k] == i5;
+        for (int q = 0; q < n_s; q++) dup |= slot[q] == luts[b].in[k];
+        if (!dup && n_s < 5) slot[n_s++] = luts[b].in[k];
+        else if (!dup) return 0;
+    }
+    uint64_t ta = lut_table_on(&luts[a], &nl->pins[a], &nl->nets, slot);
+    uint64_t tb = lut_table_on(&luts[b], &nl->pins[b], &nl->nets, slot) & 0xFFFFFFFFull;
+    if (i5 == NET_ID_PAD) {
+        *init = (ta << 32) | tb;
+        return 1;
+    }
+    *init = (ta & 0xFFFFFFFF00000000ull) | tb;
+    return (ta & 0xFFFFFFFFull) == tb;
+}
+
+static void emit_lut6d(OutBuf *o, const Netlist *nl, int a, int b, NetlistStats *st) {
+    // With six inputs in the union, every orientation and every I5 choice
+    // the Z5 side does not use is tried for an exact merge; failing that,
+    // the first usable one is kept.
+    const Lut *luts = nl->luts;
+    uint32_t slot[LUT_MAX_INPUTS], best_slot[LUT_MAX_INPUTS];
+    uint64_t init = 0, best_init = 0;
+    int best = -1, z = a, z5 = b;
+    int n_u = luts[a].n;
+    for (int k = 0; k < luts[b].n; k++) {
+        int dup = 0;
+        for (int q = 0; q < luts[a].n; q++) dup |= luts[a].in[q] == luts[b].in[k];
+        n_u += !dup;
+    }
+    for (int side = 0; side < 2 && best != 1; side++) {
+        int x = side ? b : a, y = side ? a : b;
+        if (n_u < LUT_MAX_INPUTS) {
+            best = lut6d_init(nl, x, y, NET_ID_PAD, best_slot, &best_init);
+            z = x;
+            z5 = y;
+            break;
+        }
+        for (int k = 0; k < luts[x].n && best != 1; k++) {
+            int used = 0;
+            for (int q = 0; q < luts[y].n; q++) used |= luts[y].in[q] == luts[x].in[k];
+            if (used) continue;
+            int exact = lut6d_init(nl, x, y, luts[x].in[k], slot, &init);
+            if (best < 0 || exact) {
+                best = exact;
+                best_init = init;
+                memcpy(best_slot, slot, sizeof(slot));
+                z = x;
+                z5 = y;
+            }
+        }
+    }
+    if (best < 0) { // both sides use all six inputs: Z5 cannot be exact
+        uint32_t i5 = luts[a].in[luts[a].n - 1];
+        int n_s = 0;
+        for (int k = 0; k < LUT_MAX_INPUTS; k++) if (luts[a].in[k] != i5) best_slot[n_s++] = luts[a].in[k];
+        best_slot[5] = i5;
+        uint64_t ta = lut_table_on(&luts[a], &nl->pins[a], &nl->nets, best_slot);
+        uint64_t tb = lut_table_on(&luts[b], &nl->pins[b], &nl->nets, best_slot);
+        best_init = (ta & 0xFFFFFFFF00000000ull) | (tb & 0xFFFFFFFFull);
+        best = 0;
+        z = a;
+        z5 = b;
+    }
+    if (!best) st->inexact++;
+    st->merged++;
+    init = best_init;
+    memcpy(slot, best_slot, sizeof(slot));
+    a = z;
+    b = z5;
+
+    static const char hex[] = "0123456789abcdef";
+    char lit[22] = "64'h";
+    for (int k = 0; k < 16; k++) lit[4 + k] = hex[(init >> (60 - 4 * k)) & 15];
+    lit[20] = 0;
+    out_str(o, "GTP_LUT6D #(\n    .INIT(");
+    out_str(o, lit);
+    out_str(o, ")\n  ) ");
+    out_str(o, luts[a].inst);
+    out_str(o, " (\n");
+    static const char *const pin[LUT_MAX_INPUTS] = { "I0", "I1", "I2", "I3", "I4", "I5" };
+    for (int s = 0; s < LUT_MAX_INPUTS; s++) {
+        out_str(o, "    .");
+        out_str(o, pin[s]);
+        out_put(o, "(", 1);
+        if (slot[s] != NET_ID_PAD) {
+            // Net names are stored trimmed; an escaped identifier needs the
+            // whitespace that ends it back before the ')'.
+            const char *name = nl->nets.bytes + nl->nets.offs[slot[s]];
+            out_str(o, name);
+            if (name[0] == '\\') out_put(o, " ", 1);
+        } else {
+            out_str(o, s == 5 ? "1'b1" : "1'b0");
+        }
+        out_str(o, "),\n");
+    }
+    const LutSpan *za = &nl->spans[a], *zb = &nl->spans[b];
+    out_str(o, "    .Z(");
+    out_put(o, za->z, (size_t)(za->z_end - za->z));
+    out_str(o, "),\n    .Z5(");
+    out_put(o, zb->z, (size_t)(zb->z_end - zb->z));
+    out_str(o, ")\n  );");
+}
+
+static int write_netlist(const char *path, const Netlist *nl, const int *pair_a, const int *pair_b,
+                         int n_pairs, NetlistStats *st) {
+    memset(st, 0, sizeof(*st));
+    Splice *sp = (Splice*)xmalloc((size_t)n_pairs * 2 * sizeof(Splice) + 1);
+    int n_sp = 0;
+    const char *text = nl->text.data, *text_end = text + nl->text.len;
+    for (int k = 0; k < n_pairs; k++) {
+        int a = pair_a[k], b = pair_b[k];
+        const LutSpan *sa = &nl->spans[a], *sb = &nl->spans[b];
+        if (!nl->luts[a].has_init || !nl->luts[b].has_init || !nl->pins[a].width ||
+            !nl->pins[b].width || !sa->z || !sb->z) {
+            st->skipped++;
+            continue;
+        }
+        sp[n_sp++] = (Splice){ sa->stmt, sa->stmt_end, k };
+        // Drop b's whole line when nothing else shares it.
+        const char *at = sb->stmt, *end = sb->stmt_end;
+        while (at > text && (at[-1] == ' ' || at[-1] == '\t')) at--;
+        const char *e = end;
+        while (e < text_end && (*e == ' ' || *e == '\t' || *e == '\r')) e++;
+        if ((at == text || at[-1] == '\n') && (e == text_end || *e == '\n')) end = e < text_end ? e + 1 : e;
+        else at = sb->stmt;
+        sp[n_sp++] = (Splice){ at, end, -1 };
+    }
+    qsort(sp, (size_t)n_sp, sizeof(Splice), compare_splice);
+
+    OutBuf o;
+    if (!out_open(&o, path)) { free(sp); return 0; }
+    const char *cur = text;
+    for (int k = 0; k < n_sp; k++) {
+        if (sp[k].at > cur) out_put(&o, cur, (size_t)(sp[k].at - cur));
+        if (sp[k].pair >= 0) emit_lut6d(&o, nl, pair_a[sp[k].pair], pair_b[sp[k].pair], st);
+        if (sp[k].end > cur) cur = sp[k].end;
+    }
+    out_put(&o, cur, (size_t)(text_end - cur));
+    free(sp);
+    return out_close(&o);
+}
+
+typedef lutpair_options Options;
+
+static double peak_rss_mb(void) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0.0;
+#if defined(__APPLE__)
+    return (double)ru.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+    return (double)ru.ru_maxrss / 1024.0;            // kilobytes
+#endif
+#else
+    return 0.0;
+#endif
+}
+
+// --time-limit: blossom progress rewrites the .res as the matching grows,
+// at most every ANYTIME_WRITE_INTERVAL seconds, so a burst of quick
+// augmentations costs one write; run_one writes the final result anyway.
+#define ANYTIME_WRITE_INTERVAL 0.010
+
+typedef struct {
+    const char *path;
+    const Lut *luts;
+    int n_luts;
+    int *pair_a, *pair_b;   // scratch; run_one rebuilds them from the matching
+    double last;
+    int writes;
+    int written;            // pairs in the last file written
+} AnytimeWriter;
+
+static void anytime_progress(void *arg, const int32_t *match, int augmented) {
+    AnytimeWriter *w = (AnytimeWriter*)arg;
+    (void)augmented;
+    if (!w->path || now_seconds() - w->last < ANYTIME_WRITE_INTERVAL) return;
+    int k = 0;
+    for (int v = 0; v < w->n_luts; v++) {
+        if (match[v] > v) {
+            w->pair_a[k] = v;
+            w->pair_b[k] = match[v];
+            k++;
+        }
+    }
+    if (write_res(w->path, w->luts, w->pair_a, w->pair_b, k)) {
+        w->writes++;
+        w->written = k;
+    }
+    w->last = now_seconds();
+}
+
+// Wall time per phase of one run_one call, for bench. Mapping or reading
+// the file is `read`; streaming mode reads while it parses, so there it all
+// counts as `parse`, as do pruning, the net graph and levelization.
+typedef struct {
+    double read, parse, index, match, write;   // seconds
+    int luts, pairs;                           // luts < 0: the run failed
+} RunTimes;
+
+static void sb_stats_json(StrBuf *log, const char *infile, int n_luts, int n_pairs, const RunTimes *t) {
+    // {"file":..., "luts":..., "pairs":..., "ms":{...}, "counters":{...}}; the
+    // counters are null unless built with -DLUTPAIR_STATS.
+    sb_printf(log, "{\"file\":\"");
+    for (const char *c = infile; *c; c++) {
+        if (*c == '"' || *c == '\\') sb_printf(log, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20) sb_printf(log, "\\u%04x", (unsigned char)*c);
+        else sb_printf(log, "%c", *c);
+    }
+    sb_printf(log, "\",\"luts\":%d,\"pairs\":%d,\"ms\":{\"read\":%.3f,\"parse\":%.3f,"
+              "\"index\":%.3f,\"match\":%.3f,\"write\":%.3f},\"counters\":", n_luts, n_pairs,
+              t->read * 1e3, t->parse * 1e3, t->index * 1e3, t->match * 1e3, t->write * 1e3);
+#ifdef LUTPAIR_STATS
+    const HotStats *h = &hot_stats;
+    sb_printf(log, "{\"union_calls\":%llu,\"union_fast\":%llu,\"union_rejects\":%llu,"
+              "\"sig_rejects\":%llu,\"candidates\":%llu,\"candidate_luts\":%llu,\"candidates_per_lut\":%.3f,"
+              "\"parse_bytes\":%llu,\"tokens\":%llu,\"bytes_per_token\":%.3f,"
+              "\"net_lookups\":%llu,\"net_probes\":%llu,\"net_probes_per_lookup\":%.3f,"
+              "\"net_max_probe\":%llu,\"arena_bytes\":%llu}}\n",
+              (unsigned long long)h->union_calls, (unsigned long long)h->union_fast,
+              (unsigned long long)h->union_rejects, (unsigned long long)h->sig_rejects,
+              (unsigned long long)h->candidates,
+              (unsigned long long)h->candidate_luts,
+              h->candidate_luts ? (double)h->candidates / (double)h->candidate_luts : 0.0,
+              (unsigned long long)h->parse_bytes, (unsigned long long)h->tokens,
+              h->tokens ? (double)h->parse_bytes / (double)h->tokens : 0.0,
+              (unsigned long long)h->net_lookups, (unsigned long long)h->net_probes,
+              h->net_lookups ? (double)h->net_probes / (double)h->net_lookups : 0.0,
+              (unsigned long long)h->net_max_probe, (unsigned long long)h->arena_bytes);
+#else
+    sb_printf(log, "null}\n");
+#endif
+}
+
+static int load_luts(const char *infile, const Options *opt, Netlist *nl, StrBuf *log, double *read_s) {
+    // "-" always streams: a pipe cannot be mapped.
+    int from_stdin = strcmp(infile, "-") == 0;
+    double tr = now_seconds();
+    *read_s = 0;
+
+    // The cache holds LUTs and nets only, so modes that need more parse.
+    if (opt->cache && !from_stdin && (nl->graph || nl->record_pins))
+        sb_printf(log, "  cache: not used with --graph, --preserve-depth, --netlist or --prune-inputs\n");
+    if (opt->cache && !from_stdin && !nl->graph && !nl->record_pins) {
+        double tc = now_seconds();
+        Source src;
+        if (!source_open(&src, infile)) return 0;
+        *read_s = now_seconds() - tr;
+        uint64_t h = hash_source(src.data, src.len);
+        char cpath[1024];
+        cache_path_for(infile, cpath, sizeof(cpath));
+        if (cache_load(cpath, src.len, h, nl)) {
+            source_close(&src);
+            sb_printf(log, "  cache: loaded %s %.3f ms\n", cpath, (now_seconds() - tc) * 1e3);
+            return 1;
+        }
+        parse_luts_from_buffer(src.data, src.len, nl);
+        int stored = cache_store(cpath, src.len, h, nl);
+        source_close(&src);
+        if (stored) sb_printf(log, "  cache: wrote %s\n", cpath);
+        else fprintf(stderr, "%s: cannot write %s\n", infile, cpath);
+        return 1;
+    }
+
+    // --netlist splices into the source text, so it stays mapped.
+    if (nl->record_spans) {
+        if (!source_open(&nl->text, infile)) return 0;
+        *read_s = now_seconds() - tr;
+        if (opt->compact && nl->text.mapped == 1) nl->drop = &nl->text;
+        parse_luts_from_buffer(nl->text.data, nl->text.len, nl);
+        nl->drop = NULL;
+        return 1;
+    }
+
+    if (opt->stream || from_stdin) {
+        FILE *in = from_stdin ? stdin : fopen(infile, "rb");
+        if (!in) return 0;
+        int ok = parse_luts_from_stream(in, infile, nl);
+        if (!from_stdin) fclose(in);
+        return ok;
+    }
+
+    Source src;
+    if (!source_open(&src, infile)) return 0;
+    *read_s = now_seconds() - tr;
+    if (opt->compact && src.mapped == 1) nl->drop = &src;
+    parse_luts_from_buffer(src.data, src.len, nl);
+    nl->drop = NULL;
+    source_close(&src);
+    return 1;
+}
+
+static int build_graph_logged(const Lut *luts, int n_luts, const FanoutIndex *fx, const Options *opt,
+                              int free_edges, double deadline, CompatGraph *g, StrBuf *log) {
+    double tg = now_seconds(), projected;
+    int complete = build_compat_graph(luts, n_luts, fx, free_edges, opt->threads, deadline, opt->compact, g,
+                                      &projected);
+    if (!complete && projected > 0) {
+        sb_printf(log, "  graph: skipped after %.3f ms, needs about %.0f ms of the %.0f ms left\n",
+                  (now_seconds() - tg) * 1e3, projected * 1e3, (deadline - tg) * 1e3);
+    } else if (!complete) {
+        sb_printf(log, "  graph: cut short by --time-limit after %.3f ms\n", (now_seconds() - tg) * 1e3);
+    } else if (opt->report || opt->time_limit_ms > 0 || opt->matcher == LUTPAIR_MATCHER_EXACT) {
+        sb_printf(log, "  graph: V=%u E=%u %.3f ms", g->n, g->offs[g->n] / 2, (now_seconds() - tg) * 1e3);
+        if (g->packed) sb_printf(log, ", packed %.1f MB", (double)g->pos[g->n] / (1024.0 * 1024.0));
+        sb_printf(log, "\n");
+    }
+    return complete;
+}
+
+// --matcher=exact: blossom on the full compatibility graph, where every
+// free pair (n_i + n_j <= 6) is an edge rather than --free-edges of them
+// per LUT, so a search that ends within --budget-ms proves the matching
+// maximum. Free pairs grow quadratically in the small LUTs; past
+// EXACT_MAX_FREE_PAIRS the usual sparse graph is matched instead and the
+// result is only the optimum of that graph.
+#define EXACT_MAX_FREE_PAIRS 16000000ull
+
+static uint64_t count_free_pairs(const Lut *luts, int n_luts) {
+    // Upper bound on the free edges: --preserve-depth only removes some.
+    uint64_t c[LUT_MAX_INPUTS + 1] = {0}, pairs = 0;
+    for (int i = 0; i < n_luts; i++) if (luts[i].n <= LUT_MAX_INPUTS) c[luts[i].n]++;
+    for (int a = 0; a <= LUT_MAX_INPUTS; a++) {
+        for (int b = a; a + b <= LUT_MAX_INPUTS; b++)
+            pairs += a == b ? c[a] * (c[a] - (c[a] > 0)) / 2 : c[a] * c[b];
+    }
+    return pairs;
+}
+
+// --export-graph: the compatibility graph in DIMACS edge format, vertices
+// numbered from 1 in LUT order, with a "c v" line naming each one, for an
+// external matching or ILP solver.
+static int write_dimacs(const char *path, const Lut *luts, const CompatGraph *g) {
+    char tmp[1100];
+    temp_path_for(path, tmp, sizeof(tmp));
+    OutBuf o;
+    if (!out_open(&o, tmp)) return 0;
+    out_str(&o, "p edge ");
+    out_u64(&o, g->n);
+    out_put(&o, " ", 1);
+    out_u64(&o, g->offs[g->n] / 2);
+    out_put(&o, "\n", 1);
+    for (uint32_t v = 0; v < g->n; v++) {
+        out_str(&o, "c v ");
+        out_u64(&o, (uint64_t)v + 1);
+        out_put(&o, " ", 1);
+        out_str(&o, luts[v].inst);
+        out_put(&o, "\n", 1);
+    }
+    for (uint32_t v = 0; v < g->n; v++) {
+        for (GraphRow r = graph_row(g, v); graph_next(&r); ) {
+            if (r.u <= v) continue;
+            out_str(&o, "e ");
+            out_u64(&o, (uint64_t)v + 1);
+            out_put(&o, " ", 1);
+            out_u64(&o, (uint64_t)r.u + 1);
+            out_put(&o, "\n", 1);
+        }
+    }
+    if (!out_close(&o) || rename(tmp, path) != 0) {
+        remove(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+// The stages of a testcase. load_netlist parses the design and derives
+// what the options ask for: pruned inputs, the net graph and levels.
+// index_netlist adds signatures and the fanout index. pair_netlist runs the
+// strategies and matcher on `luts` (nl->luts, or a private copy when several
+// requests share one netlist: only the used flags change) and writes the
+// outputs.
+static void netlist_setup(Netlist *nl, const Options *opt, int has_text, StrBuf *log) {
+    netlist_init(nl);
+    if (opt->graph || opt->preserve_depth) {
+        nl->graph = (NetGraph*)xmalloc(sizeof(NetGraph));
+        net_graph_init(nl->graph);
+    }
+    nl->record_pins = opt->prune;
+    if (opt->netlist) {
+        // The netlist writer splices into the source text; a pipe has none.
+        if (!has_text) sb_printf(log, "  netlist: not written for stdin\n");
+        else nl->record_pins = nl->record_spans = 1;
+    }
+}
+
+static void netlist_derive(Netlist *nl, const Options *opt, StrBuf *log) {
+    Lut *luts = nl->luts;
+    int n_luts = nl->n_luts;
+    if (opt->prune) {
+        double tp = now_seconds();
+        PruneStats ps;
+        prune_inputs(luts, nl->pins, n_luts, &nl->nets, &ps);
+        sb_printf(log, "  prune: LUTs narrowed=%d inputs removed=%d constant pins=%d %.3f ms\n",
+                  ps.narrowed, ps.removed, ps.const_pins, (now_seconds() - tp) * 1e3);
+    }
+    if (nl->graph) {
+        NetGraph *ng = nl->graph;
+        net_graph_finish(ng, (uint32_t)n_luts);
+        sb_printf(log, "  netgraph: cells=%u nets=%u driver pins=%u sink pins=%u\n",
+                  ng->n_cells, ng->nets.count, ng->drv_offs[ng->nets.count],
+                  ng->sink_offs[ng->nets.count]);
+        if (opt->preserve_depth) {
+            double tl = now_seconds();
+            LevelStats ls;
+            levelize(ng, luts, &ls);
+            sb_printf(log, "  levels: depth=%u critical LUTs=%u looped cells=%u %.3f ms\n",
+                      ls.depth, ls.critical, ls.looped, (now_seconds() - tl) * 1e3);
+        }
+    }
+}
+
+static int load_netlist(const char *infile, const Options *opt, Netlist *nl, StrBuf *log, RunTimes *times) {
+    double t0 = now_seconds();
+    netlist_setup(nl, opt, strcmp(infile, "-") != 0, log);
+    if (!load_luts(infile, opt, nl, log, &times->read)) {
+        netlist_free(nl);
+        return 0;
+    }
+    netlist_derive(nl, opt, log);
+    times->parse = now_seconds() - t0 - times->read;
+    return 1;
+}
+
+static void index_netlist(Netlist *nl, FanoutIndex *fx, RunTimes *times) {
+    double t_index = now_seconds();
+    lut_signatures(nl->luts, nl->n_luts);
+    build_fanout_index(nl, fx);
+    times->index = now_seconds() - t_index;
+}
+
+static int prepare_netlist(const char *infile, const Options *opt, Netlist *nl, FanoutIndex *fx,
+                           StrBuf *log, RunTimes *times) {
+    if (!load_netlist(infile, opt, nl, log, times)) return 0;
+    index_netlist(nl, fx, times);
+    return 1;
+}
+
+static int match_pairs(const char *infile, int idx, const Netlist *nl, Lut *luts, const FanoutIndex *fx,
+                       const Options *opt, const char *res_path, double t0, StrBuf *log, RunTimes *times,
+                       int *out_a, int *out_b, int *res_written) {
+    // The matching stage: strategies, swaps and blossom. Pairs go to out_a/out_b
+    // (n_luts / 2 entries each). With --time-limit and a res_path, the .res
+    // is rewritten as the matching grows; *res_written then says whether the
+    // file already holds the final result.
+    int n_luts = nl->n_luts;
+    double t_index = now_seconds();
+
+    // With --time-limit the first answer comes from the strategies alone;
+    // the graph for the blossom matcher is built after it is written.
+    int anytime = opt->time_limit_ms > 0;
+    double deadline = t0 + opt->time_limit_ms / 1000.0;
+    int exact = opt->matcher == LUTPAIR_MATCHER_EXACT;
+    int use_blossom = opt->matcher != LUTPAIR_MATCHER_GREEDY || anytime;
+    int first = opt->strategy == LUTPAIR_STRATEGY_ALL ? 0 : opt->strategy;
+    int last = opt->strategy == LUTPAIR_STRATEGY_ALL ? N_STRATEGIES - 1 : opt->strategy;
+    int need_graph = (use_blossom || opt->export_graph) && !anytime;
+    for (int k = first; k <= last; k++) need_graph |= strategies[k].needs_graph;
+
+    int free_edges = opt->free_edges, full_graph = 0;
+    if (exact) {
+        uint64_t fp = count_free_pairs(luts, n_luts);
+        full_graph = fp <= EXACT_MAX_FREE_PAIRS;
+        if (full_graph) free_edges = GRAPH_FREE_ALL;
+        else sb_printf(log, "  exact: %llu free pairs exceed %llu, matching the sparse graph (--free-edges=%d)\n",
+                       (unsigned long long)fp, EXACT_MAX_FREE_PAIRS, opt->free_edges);
+    }
+    CompatGraph g = {0};
+    int have_graph = 0;
+    if (need_graph) {
+        build_graph_logged(luts, n_luts, fx, opt, free_edges, 0, &g, log);
+        have_graph = 1;
+    }
+
+    // Run the selected strategies and keep the one with the most pairs.
+    int *pair_a = (int*)xmalloc((size_t)n_luts * sizeof(int) + 1);
+    int *pair_b = (int*)xmalloc((size_t)n_luts * sizeof(int) + 1);
+    int *try_a = (int*)xmalloc((size_t)n_luts * sizeof(int) + 1);
+    int *try_b = (int*)xmalloc((size_t)n_luts * sizeof(int) + 1);
+
+    // Pairs carried over from --incremental sit at the front of both pair
+    // buffers; strategies only see the LUTs they leave free.
+    int n_kept = 0;
+    if (opt->incremental) {
+        char prev[1024];
+        const char *path = opt->incremental;
+#if defined(__unix__) || defined(__APPLE__)
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            if (idx < 0) snprintf(prev, sizeof(prev), "%s/stdin_syn.res", path);
+            else snprintf(prev, sizeof(prev), "%s/design_%d_syn.res", path, idx);
+            path = prev;
+        }
+#endif
+        IncrStats is;
+        double ti = now_seconds();
+        n_kept = load_prev_pairs(path, luts, n_luts, fx, pair_a, pair_b, &is);
+        if (n_kept < 0) {
+            fprintf(stderr, "%s: cannot read %s, pairing from scratch\n", infile, path);
+            n_kept = 0;
+        } else {
+            sb_printf(log, "  incremental: %s prev=%d kept=%d invalid=%d unpaired=%d released=%d %.3f ms\n",
+                      path, is.prev, is.kept, is.invalid, is.unpaired, is.released, (now_seconds() - ti) * 1e3);
+        }
+        memcpy(try_a, pair_a, (size_t)n_kept * sizeof(int));
+        memcpy(try_b, pair_b, (size_t)n_kept * sizeof(int));
+    }
+
+    double t_match = now_seconds();
+    times->index += t_match - t_index;
+    int n_pairs = -1;
+    int strat_pairs[N_STRATEGIES];
+    for (int k = first; k <= last; k++) {
+        for (int v = 0; v < n_luts; v++) luts[v].used = 0;
+        for (int q = 0; q < n_kept; q++) luts[pair_a[q]].used = luts[pair_b[q]].used = 1;
+        PairCtx ctx = { luts, n_luts, fx, have_graph ? &g : NULL, nl->graph, try_a + n_kept, try_b + n_kept,
+                        opt->threads };
+        double ts = now_seconds();
+        int n = n_kept + strategies[k].run(&ctx);
+        double dt = now_seconds() - ts;
+        strat_pairs[k] = n;
+        if (opt->report) {
+            sb_printf(log, "  strategy=%-10s pairs=%d %.3f ms (%.0f pairs/s)\n", strategies[k].name,
+                      n, dt * 1e3, dt > 0 ? n / dt : 0.0);
+        }
+        if (n > n_pairs) {
+            int *t;
+            t = pair_a; pair_a = try_a; try_a = t;
+            t = pair_b; pair_b = try_b; try_b = t;
+            n_pairs = n;
+        }
+    }
+    free(try_a);
+    free(try_b);
+
+    AnytimeWriter aw = { res_path, luts, n_luts, pair_a, pair_b, 0.0, 0, n_pairs };
+    int graph_complete = have_graph;
+    if (anytime) {
+        // First answer, then cheap swap moves, then the graph and blossom
+        // with whatever time is left.
+        if (res_path && !write_res(res_path, luts, pair_a, pair_b, n_pairs))
+            fprintf(stderr, "Failed to write %s\n", res_path);
+        aw.last = now_seconds();
+        sb_printf(log, "  anytime: first answer pairs=%d at %.3f ms\n", n_pairs, (aw.last - t0) * 1e3);
+        if (n_luts > 1 && aw.last < deadline) {
+            double tsw = now_seconds();
+            int32_t *match = (int32_t*)xmalloc((size_t)n_luts * sizeof(int32_t));
+            for (int v = 0; v < n_luts; v++) match[v] = -1;
+            for (int k = 0; k < n_pairs; k++) {
+                match[pair_a[k]] = pair_b[k];
+                match[pair_b[k]] = pair_a[k];
+            }
+            int added = improve_swaps(luts, n_luts, fx, match, deadline, anytime_progress, &aw);
+            n_pairs = 0;
+            for (int v = 0; v < n_luts; v++) {
+                if (match[v] > v) {
+                    pair_a[n_pairs] = v;
+                    pair_b[n_pairs] = match[v];
+                    n_pairs++;
+                }
+            }
+            free(match);
+            sb_printf(log, "  anytime: swaps +%d -> %d pairs, %.3f ms\n", added, n_pairs, (now_seconds() - tsw) * 1e3);
+        }
+        if (n_luts > 1 && now_seconds() < deadline && !have_graph) {
+            graph_complete = build_graph_logged(luts, n_luts, fx, opt, free_edges, deadline, &g, log);
+            have_graph = 1;
+        }
+    }
+
+    if (use_blossom && graph_complete && n_luts > 1 && (!anytime || now_seconds() < deadline)) {
+        // Warm start from the best strategy, then augment towards a maximum matching.
+        double tb = now_seconds();
+        int32_t *match = (int32_t*)xmalloc((size_t)n_luts * sizeof(int32_t));
+        for (int v = 0; v < n_luts; v++) match[v] = -1;
+        for (int k = 0; k < n_pairs; k++) {
+            match[pair_a[k]] = pair_b[k];
+            match[pair_b[k]] = pair_a[k];
+        }
+        int greedy_pairs = n_pairs;
+        int timed_out = 0;
+        double budget = anytime ? deadline - tb : opt->budget_ms / 1000.0;
+        n_pairs += match_blossom(&g, match, budget, &timed_out, anytime ? anytime_progress : NULL, &aw);
+        for (int v = 0, k = 0; v < n_luts; v++) {
+            if (match[v] > v) {
+                pair_a[k] = v;
+                pair_b[k] = match[v];
+                k++;
+            }
+        }
+        sb_printf(log, "  blossom: V=%u E=%u greedy=%d -> %d pairs, %.3f s%s\n",
+                  g.n, g.offs[g.n] / 2, greedy_pairs, n_pairs, now_seconds() - tb,
+                  timed_out ? " (budget exhausted)" : "");
+        free(match);
+        if (exact) {
+            // Gap of each heuristic to the best matching found; with the full
+            // graph and no timeout that is the optimum.
+            int proven = full_graph && !timed_out;
+            sb_printf(log, "  exact: %s=%d%s\n", proven ? "optimum" : "best", n_pairs,
+                      proven ? "" : timed_out ? " (not proven: budget exhausted)"
+                                              : " (not proven: sparse graph)");
+            for (int k = first; k <= last; k++) {
+                int gap = n_pairs - strat_pairs[k];
+                sb_printf(log, "  exact: strategy=%-10s pairs=%d gap=%d (%.2f%%)\n", strategies[k].name,
+                          strat_pairs[k], gap, n_pairs ? 100.0 * gap / n_pairs : 0.0);
+            }
+        }
+    }
+    if (opt->export_graph && graph_complete) {
+        char gpath[256];
+        if (idx < 0) snprintf(gpath, sizeof(gpath), "stdin_syn.dimacs");
+        else snprintf(gpath, sizeof(gpath), "design_%d_syn.dimacs", idx);
+        if (write_dimacs(gpath, luts, &g)) sb_printf(log, "  graph: wrote %s\n", gpath);
+        else fprintf(stderr, "Failed to write %s\n", gpath);
+    }
+    if (anytime) {
+        if (res_path && n_pairs > aw.written && write_res(res_path, luts, pair_a, pair_b, n_pairs)) {
+            aw.writes++;
+            aw.written = n_pairs;
+        }
+        sb_printf(log, "  anytime: pairs=%d rewrites=%d limit %d ms\n", n_pairs, aw.writes, opt->time_limit_ms);
+    }
+    if (have_graph) free_compat_graph(&g);
+
+    times->match = now_seconds() - t_match;
+    memcpy(out_a, pair_a, (size_t)n_pairs * sizeof(int));
+    memcpy(out_b, pair_b, (size_t)n_pairs * sizeof(int));
+    *res_written = res_path && anytime && aw.written == n_pairs;
+    free(pair_a);
+    free(pair_b);
+    return n_pairs;
+}
+
+static int pair_netlist(const char *infile, int idx, const Netlist *nl, Lut *luts, const FanoutIndex *fx,
+                        const Options *opt, const char *outfile, double t0, StrBuf *log, RunTimes *times) {
+    int n_luts = nl->n_luts;
+    int *pair_a = (int*)xmalloc(((size_t)n_luts / 2 + 1) * sizeof(int));
+    int *pair_b = (int*)xmalloc(((size_t)n_luts / 2 + 1) * sizeof(int));
+    int written;
+    int n_pairs = match_pairs(infile, idx, nl, luts, fx, opt, outfile, t0, log, times, pair_a, pair_b, &written);
+
+    double t_write = now_seconds();
+    if (!written && !write_res(outfile, luts, pair_a, pair_b, n_pairs))
+        fprintf(stderr, "Failed to write %s\n", outfile);
+    if (nl->record_spans) {
+        char netfile[256];
+        NetlistStats ns;
+        double tw = now_seconds();
+        snprintf(netfile, sizeof(netfile), "design_%d_syn_lut6d.v", idx);
+        if (!write_netlist(netfile, nl, pair_a, pair_b, n_pairs, &ns)) {
+            fprintf(stderr, "Failed to write %s\n", netfile);
+        } else {
+            sb_printf(log, "  netlist: %d GTP_LUT6D (%d not function-exact), %d pairs skipped, "
+                      "%.3f ms -> %s\n", ns.merged, ns.inexact, ns.skipped, (now_seconds() - tw) * 1e3, netfile);
+        }
+    }
+
+    times->write = now_seconds() - t_write;
+    times->luts = n_luts;
+    times->pairs = n_pairs;
+    free(pair_a);
+    free(pair_b);
+    return n_pairs;
+}
+
+static void run_one(const char *infile, int idx, const Options *opt, int process_peak, StrBuf *log,
+                    RunTimes *rt) {
+    // process_peak: other testcases run in this process too, so getrusage's
+    // peak is the process's so far and the summary labels it as such.
+    double t0 = now_seconds();
+    RunTimes times = {0};
+    if (rt) rt->luts = -1;
+#ifdef LUTPAIR_STATS
+    if (opt->stats) memset(&hot_stats, 0, sizeof(hot_stats));
+#endif
+
+    Netlist nl;
+    FanoutIndex fx;
+    if (!prepare_netlist(infile, opt, &nl, &fx, log, &times)) {
+        fprintf(stderr, "Failed to read %s\n", infile);
+        return;
+    }
+    char outfile[256];
+    if (idx < 0) snprintf(outfile, sizeof(outfile), "stdin_syn.res");
+    else snprintf(outfile, sizeof(outfile), "design_%d_syn.res", idx);
+    int n_pairs = pair_netlist(infile, idx, &nl, nl.luts, &fx, opt, outfile, t0, log, &times);
+    free_fanout_index(&fx);
+
+    double t_end = now_seconds();
+    sb_printf(log, "%s: LUTs=%d pairs=%d time=%.3f s rss=%.1f MB%s -> %s\n", infile, nl.n_luts, n_pairs,
+              t_end - t0, peak_rss_mb(), process_peak ? " (process peak)" : "", outfile);
+    if (opt->stats) sb_stats_json(log, infile, nl.n_luts, n_pairs, &times);
+    if (rt) *rt = times;
+    netlist_free(&nl);
+}
+
+// Batch scheduler. Testcases run concurrently, largest file first so a big
+// design does not end up alone at the tail, and share the -j thread budget:
+// min(jobs, budget) testcases run at once. A testcase takes its threads for
+// the graph construction when it starts: an even split of the free budget
+// between itself and the testcases that can still start beside it, plus the
+// remainder, so the largest gets the most. Threads go back to the budget as
+// a testcase finishes, for the ones that start later. Reports are printed
+// in job order (argument order, or ascending index for a directory scan) as
+// soon as every earlier job has finished.
+typedef struct {
+    char *path;
+    int idx;
+    long long size;   // bytes; 0 for stdin or when unknown
+    StrBuf log;
+    int done;
+} Job;
+
+typedef struct {
+    Job *jobs;
+    int n_jobs;
+    int *order;       // job indices, largest first
+    int next;         // next entry of `order` to start
+    int next_print;   // first job whose report has not been printed
+    int workers;
+    int running;      // testcases started and not finished
+    int free_threads; // thread budget not held by a running testcase
+    Options opt;
+#ifdef LUTPAIR_THREADS
+    pthread_mutex_t lock;
+#endif
+} Batch;
+
+static const Batch *sort_batch; // qsort has no context argument; main only
+
+static int compare_job_size(const void *a, const void *b) {
+    const Job *x = &sort_batch->jobs[*(const int*)a], *y = &sort_batch->jobs[*(const int*)b];
+    if (x->size != y->size) return x->size < y->size ? 1 : -1;
+    return (*(const int*)a > *(const int*)b) - (*(const int*)a < *(const int*)b);
+}
+
+static int compare_job_idx(const void *a, const void *b) {
+    const Job *x = (const Job*)a, *y = (const Job*)b;
+    if (x->idx != y->idx) return (x->idx > y->idx) - (x->idx < y->idx);
+    return strcmp(x->path, y->path);
+}
+
+static void batch_lock(Batch *b) {
+#ifdef LUTPAIR_THREADS
+    pthread_mutex_lock(&b->lock);
+#else
+    (void)b;
+#endif
+}
+
+static void batch_unlock(Batch *b) {
+#ifdef LUTPAIR_THREADS
+    pthread_mutex_unlock(&b->lock);
+#else
+    (void)b;
+#endif
+}
+
+static void batch_worker(void *arg, int tid, int n_threads) {
+    (void)tid;
+    (void)n_threads;
+    Batch *b = (Batch*)arg;
+    for (;;) {
+        Options opt = b->opt;
+        batch_lock(b);
+        int k = b->next < b->n_jobs ? b->order[b->next++] : -1;
+        if (k >= 0) {
+            int later = b->n_jobs - b->next, idle = b->workers - b->running - 1;
+            int reserve = later < idle ? later : idle;
+            int share = b->free_threads / (reserve + 1);
+            opt.threads = b->free_threads - share * reserve;
+            if (opt.threads < 1) opt.threads = 1;
+            b->free_threads -= opt.threads;
+            b->running++;
+        }
+        batch_unlock(b);
+        if (k < 0) break;
+
+        Job *job = &b->jobs[k];
+        run_one(job->path, job->idx, &opt, b->n_jobs > 1, &job->log, NULL);
+
+        batch_lock(b);
+        b->free_threads += opt.threads;
+        b->running--;
+        job->done = 1;
+        while (b->next_print < b->n_jobs && b->jobs[b->next_print].done) {
+            Job *p = &b->jobs[b->next_print++];
+            if (p->log.len) fwrite(p->log.s, 1, p->log.len, stdout);
+            fflush(stdout);
+        }
+        batch_unlock(b);
+    }
+}
+
+static void add_job(Job **jobs, int *n, int *cap, const char *path, int idx) {
+    if (*n == *cap) {
+        *cap = *cap ? *cap * 2 : 16;
+        *jobs = (Job*)xrealloc(*jobs, (size_t)*cap * sizeof(Job));
+    }
+    Job *job = &(*jobs)[(*n)++];
+    memset(job, 0, sizeof(*job));
+    size_t len = strlen(path);
+    job->path = (char*)xmalloc(len + 1);
+    memcpy(job->path, path, len + 1);
+    job->idx = idx;
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat st;
+    if (strcmp(path, "-") != 0 && stat(path, &st) == 0) job->size = (long long)st.st_size;
+#endif
+}
+
+// Collect design_<n>.v / design_<n>_syn.v from the current directory in
+// ascending index order.
+static int scan_design_dir(Job **jobs, int *n_jobs, int *cap) {
+    // No directory listing allowed portably without dirent; use dirent if available.
+    // We'll use dirent on POSIX; fallback to trying design_0..design_9999.
+#if defined(__unix__) || defined(__APPLE__)
+    DIR *d = opendir(".");
+    if (!d) {
+        fprintf(stderr, "Cannot open current directory\n");
+        return -1;
+    }
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        int idx;
+        if (match_design_v(de->d_name, &idx)) add_job(jobs, n_jobs, cap, de->d_name, idx);
+    }
+    closedir(d);
+
+    qsort(*jobs, (size_t)*n_jobs, sizeof(Job), compare_job_idx);
+    // design_<n>.v and design_<n>_syn.v both write design_<n>_syn.res; keep one.
+    Job *js = *jobs;
+    int kept = 0;
+    for (int k = 0; k < *n_jobs; k++) {
+        if (kept > 0 && js[kept - 1].idx == js[k].idx) {
+            fprintf(stderr, "Skipping %s (same index as %s)\n", js[k].path, js[kept - 1].path);
+            free(js[k].path);
+            continue;
+        }
+        js[kept++] = js[k];
+    }
+    *n_jobs = kept;
+#else
+    for (int idx = 0; idx <= 9999; idx++) {
+        char name[256];
+        snprintf(name, sizeof(name), "design_%d.v", idx);
+        FILE *f = fopen(name, "rb");
+        if (!f) {
+            snprintf(name, sizeof(name), "design_%d_syn.v", idx);
+            f = fopen(name, "rb");
+        }
+        if (!f) continue;
+        fclose(f);
+        add_job(jobs, n_jobs, cap, name, idx);
+    }
+#endif
+    return 0;
+}
+
+static void run_batch(Job *jobs, int n_jobs, const Options *opt) {
+    if (n_jobs == 0) return;
+    Batch b;
+    b.jobs = jobs;
+    b.n_jobs = n_jobs;
+    b.next = 0;
+    b.next_print = 0;
+    b.opt = *opt;
+    int workers = opt->threads < n_jobs ? opt->threads : n_jobs;
+    if (workers < 1 || opt->stats) workers = 1;  // --stats counters are process-wide
+    b.workers = workers;
+    b.running = 0;
+    b.free_threads = opt->threads > 1 ? opt->threads : 1;
+
+    b.order = (int*)xmalloc((size_t)n_jobs * sizeof(int));
+    for (int k = 0; k < n_jobs; k++) b.order[k] = k;
+    sort_batch = &b;
+    qsort(b.order, (size_t)n_jobs, sizeof(int), compare_job_size);
+
+#ifdef LUTPAIR_THREADS
+    pthread_mutex_init(&b.lock, NULL);
+#endif
+    parallel_run(workers, batch_worker, &b);
+#ifdef LUTPAIR_THREADS
+    pthread_mutex_destroy(&b.lock);
+#endif
+    free(b.order);
+}
+
+// lutpair bench: run each testcase `reps` times through run_one and report
+// the median and 95th percentile wall time of every phase, with throughput
+// in LUTs/s and MB/s for parsing and for the whole run. Output files are
+// written as usual (writing is one of the phases); per-run reports are
+// discarded.
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_quantiles(double *v, int n, double *median, double *p95) {
+    qsort(v, (size_t)n, sizeof(double), compare_double);
+    int k95 = (95 * n + 99) / 100 - 1;
+    *median = n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+    *p95 = v[k95 < 0 ? 0 : k95];
+}
+
+// bench --layout: pair_first_fit on the Lut records (pair_first_fit_aos)
+// against the LutSoA scan, with hardware cache counters where the kernel
+// lets us open them (Linux perf events; perf_event_paranoid <= 2 suffices
+// for user-space counting). Counts cover the calling thread only.
+enum { PERF_REFS, PERF_MISSES, PERF_L1D_MISSES, N_PERF };
+
+typedef struct {
+    int fd[N_PERF];
+} PerfCounters;
+
+static void perf_open(PerfCounters *pc) {
+    for (int k = 0; k < N_PERF; k++) pc->fd[k] = -1;
+#ifdef LUTPAIR_PERF
+    static const uint64_t cfg[N_PERF][2] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    };
+    for (int k = 0; k < N_PERF; k++) {
+        struct perf_event_attr at;
+        memset(&at, 0, sizeof(at));
+        at.size = sizeof(at);
+        at.type = (uint32_t)cfg[k][0];
+        at.config = cfg[k][1];
+        at.disabled = 1;
+        at.exclude_kernel = 1;
+        at.exclude_hv = 1;
+        pc->fd[k] = (int)syscall(SYS_perf_event_open, &at, 0, -1, -1, 0);
+    }
+#endif
+}
+
+static void perf_start(PerfCounters *pc) {
+#ifdef LUTPAIR_PERF
+    for (int k = 0; k < N_PERF; k++) {
+        if (pc->fd[k] < 0) continue;
+        ioctl(pc->fd[k], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc->fd[k], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)pc;
+#endif
+}
+
+static void perf_stop(PerfCounters *pc, int64_t *out) {
+    for (int k = 0; k < N_PERF; k++) {
+        out[k] = -1;
+#ifdef LUTPAIR_PERF
+        uint64_t v;
+        if (pc->fd[k] < 0) continue;
+        ioctl(pc->fd[k], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(pc->fd[k], &v, sizeof(v)) == (ssize_t)sizeof(v)) out[k] = (int64_t)v;
+#endif
+    }
+}
+
+static void perf_close(PerfCounters *pc) {
+#ifdef LUTPAIR_PERF
+    for (int k = 0; k < N_PERF; k++) if (pc->fd[k] >= 0) close(pc->fd[k]);
+#else
+    (void)pc;
+#endif
+}
+
+static int compare_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void run_layout_bench(const Job *jobs, int n_jobs, const Options *opt, int reps) {
+    static const char *const name[2] = { "aos", "soa" };
+    PerfCounters pc;
+    perf_open(&pc);
+    double *ms = (double*)xmalloc((size_t)reps * sizeof(double));
+    int64_t *cnt = (int64_t*)xmalloc((size_t)reps * N_PERF * sizeof(int64_t));
+    int64_t *col = (int64_t*)xmalloc((size_t)reps * sizeof(int64_t));
+    for (int j = 0; j < n_jobs; j++) {
+        Netlist nl;
+        netlist_init(&nl);
+        StrBuf log = {0};
+        double read_s;
+        int ok = load_luts(jobs[j].path, opt, &nl, &log, &read_s);
+        free(log.s);
+        if (!ok) {
+            fprintf(stderr, "Failed to read %s\n", jobs[j].path);
+            netlist_free(&nl);
+            continue;
+        }
+        lut_signatures(nl.luts, nl.n_luts);
+        FanoutIndex fx;
+        build_fanout_index(&nl, &fx);
+        int *pa = (int*)xmalloc((size_t)nl.n_luts * sizeof(int) + 1);
+        int *pb = (int*)xmalloc((size_t)nl.n_luts * sizeof(int) + 1);
+        printf("layout %s: LUTs=%d first-fit, %d reps (Lut is %d bytes, SoA row %d)\n", jobs[j].path,
+               nl.n_luts, reps, (int)sizeof(Lut), (int)(sizeof(uint32_t) * LUT_MAX_INPUTS + 1 + 8));
+        printf("  %-4s %7s %10s %12s %12s %9s %12s\n", "", "pairs", "median ms", "cache refs",
+               "cache misses", "miss rate", "L1D misses");
+        for (int v = 0; v < 2; v++) {
+            int pairs = 0;
+            for (int r = 0; r < reps; r++) {
+                for (int k = 0; k < nl.n_luts; k++) nl.luts[k].used = 0;
+                perf_start(&pc);
+                double t = now_seconds();
+                pairs = v ? pair_first_fit(nl.luts, nl.n_luts, &fx, pa, pb)
+                          : pair_first_fit_aos(nl.luts, nl.n_luts, &fx, pa, pb);
+                ms[r] = (now_seconds() - t) * 1e3;
+                perf_stop(&pc, cnt + (size_t)r * N_PERF);
+            }
+            double med, p95;
+            bench_quantiles(ms, reps, &med, &p95);
+            int64_t m[N_PERF];
+            for (int k = 0; k < N_PERF; k++) {
+                for (int r = 0; r < reps; r++) col[r] = cnt[(size_t)r * N_PERF + k];
+                qsort(col, (size_t)reps, sizeof(int64_t), compare_i64);
+                m[k] = col[reps / 2];
+            }
+            printf("  %-4s %7d %10.3f", name[v], pairs, med);
+            if (m[PERF_REFS] >= 0 && m[PERF_MISSES] >= 0) {
+                printf(" %12lld %12lld %8.2f%%", (long long)m[PERF_REFS], (long long)m[PERF_MISSES],
+                       m[PERF_REFS] ? 100.0 * (double)m[PERF_MISSES] / (double)m[PERF_REFS] : 0.0);
+            } else {
+                printf(" %12s %12s %9s", "n/a", "n/a", "n/a");
+            }
+            if (m[PERF_L1D_MISSES] >= 0) printf(" %12lld\n", (long long)m[PERF_L1D_MISSES]);
+            else printf(" %12s\n", "n/a");
+        }
+        fflush(stdout);
+        free(pa);
+        free(pb);
+        free_fanout_index(&fx);
+        netlist_free(&nl);
+    }
+    free(ms);
+    free(cnt);
+    free(col);
+    perf_close(&pc);
+}
+
+static void run_bench(const Job *jobs, int n_jobs, const Options *opt, int reps) {
+    static const char *const phase[] = { "read", "parse", "index", "match", "write", "total" };
+    enum { N_PHASES = 6 };
+    double *samples = (double*)xmalloc((size_t)reps * N_PHASES * sizeof(double));
+    for (int j = 0; j < n_jobs; j++) {
+        const Job *job = &jobs[j];
+        RunTimes rt = {0};
+        int ok = 1;
+        for (int r = 0; r < reps && ok; r++) {
+            StrBuf log = {0};
+            run_one(job->path, job->idx, opt, 0, &log, &rt);
+            free(log.s);
+            ok = rt.luts >= 0;
+            double *v = samples + (size_t)r * N_PHASES;
+            v[0] = rt.read;
+            v[1] = rt.parse;
+            v[2] = rt.index;
+            v[3] = rt.match;
+            v[4] = rt.write;
+            v[5] = rt.read + rt.parse + rt.index + rt.match + rt.write;
+        }
+        if (!ok) continue;
+
+        double mb = (double)job->size / (1024.0 * 1024.0);
+        printf("bench %s: LUTs=%d pairs=%d size=%.1f MB reps=%d\n", job->path, rt.luts, rt.pairs, mb, reps);
+        printf("  %-6s %10s %10s\n", "phase", "median ms", "p95 ms");
+        double *col = (double*)xmalloc((size_t)reps * sizeof(double));
+        for (int p = 0; p < N_PHASES; p++) {
+            double med, p95;
+            for (int r = 0; r < reps; r++) col[r] = samples[(size_t)r * N_PHASES + p];
+            bench_quantiles(col, reps, &med, &p95);
+            printf("  %-6s %10.3f %10.3f", phase[p], med * 1e3, p95 * 1e3);
+            double secs = p == 1 ? med : p == 5 ? med : 0;
+            if (secs > 0) printf("   %.0f LUTs/s  %.1f MB/s", rt.luts / secs, mb / secs);
+            printf("\n");
+        }
+        free(col);
+        fflush(stdout);
+    }
+    free(samples);
+}
+
+// lutpair regress: every strategy on every testcase, with the .res checked
+// on its own (and merged into a --netlist that is read back) and the
+// numbers compared against a baseline CSV, so a change that gets faster by
+// dropping merges fails. Each case runs `reps` times in a child process
+// (where fork exists), which reports median phase times and its own peak
+// RSS through a pipe; elsewhere the cases run in-process and rss is the
+// process peak so far. LUTs/s comes from the median total; with every case
+// timed for at least REGRESS_MIN_SECONDS that is steadier than the fastest
+// repetition, which one lucky run decides. A case fails when
+// its .res or netlist is invalid, it makes fewer pairs than the baseline, or
+// its LUTs/s falls more than `tolerance` percent below it. Cases missing
+// from the baseline only get the checks.
+typedef struct {
+    int luts, pairs;                            // luts < 0: the run failed
+    double read, parse, index, match, write;    // median seconds
+    double total;
+    double rss_mb;
+    int bad;                                    // problems check_res and check_netlist found
+} RegressRun;
+
+typedef struct {
+    char file[256];
+    char strategy[32];
+    int pairs;
+    double luts_per_s;
+    double host_mops;   // regress_calibrate next to the case; 0 if not recorded
+} RegressBase;
+
+// Short cases are repeated beyond --reps until the runs add up to
+// REGRESS_MIN_SECONDS: a 4 ms design_9 case timed five times is at the
+// mercy of one scheduler hiccup.
+#define REGRESS_MIN_SECONDS 0.1
+#define REGRESS_MAX_REPS 1000
+
+static void regress_measure(const Job *job, const Options *opt, int reps, RegressRun *out) {
+    int cap = reps;
+    double *samples = (double*)xmalloc((size_t)cap * 6 * sizeof(double));
+    RunTimes rt = {0};
+    double spent = 0.0;
+    int runs = 0;
+    out->luts = -1;
+    for (; runs < reps || (spent < REGRESS_MIN_SECONDS && runs < REGRESS_MAX_REPS); runs++) {
+        if (runs == cap) {
+            cap *= 2;
+            samples = (double*)xrealloc(samples, (size_t)cap * 6 * sizeof(double));
+        }
+        StrBuf log = {0};
+        run_one(job->path, job->idx, opt, 0, &log, &rt);
+        free(log.s);
+        if (rt.luts < 0) {
+            free(samples);
+            return;
+        }
+        double *v = samples + (size_t)runs * 6;
+        v[0] = rt.read;
+        v[1] = rt.parse;
+        v[2] = rt.index;
+        v[3] = rt.match;
+        v[4] = rt.write;
+        v[5] = rt.read + rt.parse + rt.index + rt.match + rt.write;
+        spent += v[5];
+    }
+    double med[6], p95, *col = (double*)xmalloc((size_t)runs * sizeof(double));
+    for (int p = 0; p < 6; p++) {
+        for (int r = 0; r < runs; r++) col[r] = samples[(size_t)r * 6 + p];
+        bench_quantiles(col, runs, &med[p], &p95);
+    }
+    free(col);
+    free(samples);
+    out->luts = rt.luts;
+    out->pairs = rt.pairs;
+    out->read = med[0];
+    out->parse = med[1];
+    out->index = med[2];
+    out->match = med[3];
+    out->write = med[4];
+    out->total = med[5];
+    out->rss_mb = peak_rss_mb();
+}
+
+static void scan_cell_decls(const char *p, const char *end, NetTable *inst, Token **cell, uint32_t *cap) {
+    // Instance name -> cell type for every "<cell> [#(...)] <inst> (...);"
+    // statement, by a scan of its own: words split at whitespace, '(' and
+    // '#', so the .res check does not rest on parse_luts_span. Other
+    // statements (module, wire, assign) add harmless entries.
+    while (p < end) {
+        if (isspace((unsigned char)*p)) { p++; continue; }
+        if (end - p >= 2 && p[0] == '/' && p[1] == '/') {
+            while (p < end && *p != '\n') p++;
+            continue;
+        }
+        if (end - p >= 2 && p[0] == '/' && p[1] == '*') {
+            for (p += 2; end - p >= 2 && !(p[0] == '*' && p[1] == '/'); p++) {}
+            p = end - p >= 2 ? p + 2 : end;
+            continue;
+        }
+        if (*p == '`') { // directive line
+            while (p < end && *p != '\n') p++;
+            continue;
+        }
+        if (end - p >= 2 && p[0] == '(' && p[1] == '*') {
+            for (p += 2; end - p >= 2 && !(p[0] == '*' && p[1] == ')'); p++) {}
+            p = end - p >= 2 ? p + 2 : end;
+            continue;
+        }
+        Token c = { p, 0 };
+        while (p < end && !isspace((unsigned char)*p) && *p != '(' && *p != '#' && *p != ';') p++;
+        c.len = (size_t)(p - c.s);
+        if (c.len == 9 && memcmp(c.s, "endmodule", 9) == 0) continue;
+        while (p < end && isspace((unsigned char)*p)) p++;
+        if (p < end && *p == '#') {
+            int depth = 0;
+            for (p++; p < end; p++) {
+                if (*p == '(') depth++;
+                else if (*p == ')' && --depth <= 0) { p++; break; }
+            }
+            while (p < end && isspace((unsigned char)*p)) p++;
+        }
+        const char *n = p;
+        if (p < end && *p == '\\') {
+            while (p < end && !isspace((unsigned char)*p)) p++;
+        } else {
+            while (p < end && !isspace((unsigned char)*p) && *p != '(' && *p != ';' && *p != ',') p++;
+        }
+        if (p > n && c.len) {
+            uint32_t id = net_intern(inst, n, (size_t)(p - n));
+            if (id >= *cap) {
+                *cap = *cap ? *cap * 2 : 4096;
+                *cell = (Token*)xrealloc(*cell, (size_t)*cap * sizeof(Token));
+            }
+            if (id == inst->count - 1) (*cell)[id] = c;
+        }
+        // to the end of the statement, stepping over escaped names
+        while (p < end && *p != ';') {
+            if (*p == '\\') while (p < end && !isspace((unsigned char)*p)) p++;
+            else p++;
+        }
+        if (p < end) p++;
+    }
+}
+
+static int check_res(const char *res_path, const Netlist *nl, int *pair_a, int *pair_b, int *n_valid) {
+    // Independent of the pairing code: the .res must name `count` pairs of
+    // distinct GTP_LUT<k> instances, with no instance twice and every input
+    // union within six. The cell type is read again from the source text
+    // (nl loaded with netlist set) and must be one of GTP_LUT1..6 spelled
+    // out, so a GTP_LUT6CARRY the parser let through still fails.
+    // The pairs that pass go to pair_a/pair_b (room for n_luts / 2). Prints
+    // the first few problems and returns how many there were.
+    *n_valid = 0;
+    long len = 0;
+    char *buf = read_entire_file(res_path, &len);
+    if (!buf) {
+        printf("  %s: cannot read\n", res_path);
+        return 1;
+    }
+    NetTable names;
+    net_table_init(&names);
+    int32_t *by_id = (int32_t*)xmalloc((size_t)nl->n_luts * sizeof(int32_t) + 1);
+    uint8_t *seen = (uint8_t*)calloc((size_t)nl->n_luts + 1, 1);
+    if (!seen) { fprintf(stderr, "OOM\n"); exit(1); }
+    for (int v = 0; v < nl->n_luts; v++) {
+        uint32_t id = net_intern(&names, nl->luts[v].inst, strlen(nl->luts[v].inst));
+        if (id == names.count - 1) by_id[id] = v;
+    }
+    static const char *const lut_cells[] = { "GTP_LUT1", "GTP_LUT2", "GTP_LUT3", "GTP_LUT4", "GTP_LUT5", "GTP_LUT6" };
+    NetTable decl;
+    net_table_init(&decl);
+    Token *decl_cell = NULL;
+    uint32_t decl_cap = 0;
+    if (nl->text.data) scan_cell_decls(nl->text.data, nl->text.data + nl->text.len, &decl, &decl_cell, &decl_cap);
+
+    int errors = 0, n_pairs = 0, line = 1;
+    long count = -1;
+    char cell_why[160];
+    const char *p = buf, *end = buf + len;
+    while (p < end) {
+        const char *eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        Token tok[3];
+        int n_tok = 0;
+        for (const char *q = p; q < eol && n_tok < 3; ) {
+            while (q < eol && isspace((unsigned char)*q)) q++;
+            if (q >= eol) break;
+            tok[n_tok].s = q;
+            while (q < eol && !isspace((unsigned char)*q)) q++;
+            tok[n_tok].len = (size_t)(q - tok[n_tok].s);
+            n_tok++;
+        }
+        p = eol + (eol < end);
+        if (n_tok == 0) { line++; continue; }
+        const char *why = NULL;
+        if (count < 0) {
+            char *num_end;
+            count = strtol(tok[0].s, &num_end, 10);
+            if (n_tok != 1 || num_end != tok[0].s + tok[0].len || count < 0) {
+                why = "first line is not a pair count";
+                count = 0;
+            }
+        } else if (n_tok != 2) {
+            why = "expected two instance names";
+        } else {
+            int v[2];
+            n_pairs++;
+            for (int e = 0; e < 2; e++) {
+                uint32_t id = net_lookup(&names, tok[e].s, tok[e].len);
+                v[e] = id == NET_ID_PAD ? -1 : by_id[id];
+            }
+            for (int e = 0; e < 2 && !why && nl->text.data; e++) {
+                uint32_t id = net_lookup(&decl, tok[e].s, tok[e].len);
+                if (id == NET_ID_PAD) {
+                    why = "instance not declared in the netlist";
+                } else if (!token_in(decl_cell[id], lut_cells, 6)) {
+                    snprintf(cell_why, sizeof(cell_why), "%.*s is a %.*s; only GTP_LUT1..6 pair", (int)tok[e].len,
+                             tok[e].s, (int)(decl_cell[id].len < 40 ? decl_cell[id].len : 40), decl_cell[id].s);
+                    why = cell_why;
+                }
+            }
+            if (!why && (v[0] < 0 || v[1] < 0)) why = "not a GTP_LUT1..6 instance (GTP_LUT6CARRY and other cells do not pair)";
+            else if (!why && (v[0] == v[1] || seen[v[0]] || seen[v[1]])) why = "instance used more than once";
+            else if (!why) {
+                const Lut *a = &nl->luts[v[0]], *b = &nl->luts[v[1]];
+                if (a->n > LUT_MAX_INPUTS || b->n > LUT_MAX_INPUTS ||
+                    a->n + b->n - lut_shared_count(a, b) > LUT_MAX_INPUTS) why = "input union exceeds six";
+                else if (*n_valid < nl->n_luts / 2) {
+                    pair_a[*n_valid] = v[0];
+                    pair_b[(*n_valid)++] = v[1];
+                }
+                seen[v[0]] = seen[v[1]] = 1;
+            }
+        }
+        if (why && errors++ < 5) printf("  %s:%d: %s\n", res_path, line, why);
+        line++;
+    }
+    if (count >= 0 && count != n_pairs && errors++ < 5)
+        printf("  %s: count %ld but %d pairs\n", res_path, count, n_pairs);
+    if (count < 0 && errors++ < 5) printf("  %s: empty\n", res_path);
+    net_table_free(&names);
+    net_table_free(&decl);
+    free(decl_cell);
+    free(by_id);
+    free(seen);
+    free(buf);
+    return errors;
+}
+
+static const char *check_connection(const char *p, const char *end, Token *net) {
+    // p is just past a port's '('. One net (optionally with a bit select)
+    // or constant, then ')'; an escaped identifier runs to whitespace, so a
+    // missing one swallows the ')'. Returns the position after the ')', or
+    // NULL.
+    while (p < end && isspace((unsigned char)*p)) p++;
+    net->s = p;
+    if (p < end && *p == '\\') {
+        while (p < end && !isspace((unsigned char)*p)) p++;
+    } else {
+        while (p < end && (is_ident_char((unsigned char)*p) || *p == '\'')) p++;
+    }
+    net->len = (size_t)(p - net->s);
+    const char *q = p;
+    while (q < end && isspace((unsigned char)*q)) q++;
+    if (q < end && *q == '[') {
+        q = (const char*)memchr(q, ']', (size_t)(end - q));
+        if (!q) return NULL;
+        p = q + 1;
+        net->len = (size_t)(p - net->s);
+    }
+    while (p < end && isspace((unsigned char)*p)) p++;
+    return net->len && p < end && *p == ')' ? p + 1 : NULL;
+}
+
+static int check_netlist(const char *path, const Netlist *nl, int merged) {
+    // Re-reads a written --netlist: it must parse back to the LUTs that were
+    // not merged, and each GTP_LUT6D must connect I0..I5, Z and Z5 once
+    // each, with every input net one of the source's. Prints the first few
+    // problems and returns how many there were.
+    long len = 0;
+    char *buf = read_entire_file(path, &len);
+    if (!buf) {
+        printf("  %s: cannot read\n", path);
+        return 1;
+    }
+    int errors = 0, cells = 0;
+    const char *p = buf, *end = buf + len;
+    for (;;) {
+        const char *at = p;
+        while (end - at >= 9 && !(memcmp(at, "GTP_LUT6D", 9) == 0 && (at == buf || isspace((unsigned char)at[-1])) &&
+                                  (end - at == 9 || !is_ident_char((unsigned char)at[9]))))
+            at++;
+        if (end - at < 9) break;
+        cells++;
+        p = at + 9;
+        const char *why = NULL;
+        Token inst, port, net;
+        unsigned seen = 0;  // bits 0-5: I0..I5, 6: Z, 7: Z5
+        skip_spaces(&p, end);
+        if (p < end && *p == '#') p = parse_param_block(p + 1, end, NULL);
+        if (!p || !parse_identifier(&p, end, &inst)) why = "no instance name";
+        if (!why) skip_spaces(&p, end);
+        if (!why && (p >= end || *p++ != '(')) why = "no port list";
+        while (!why) {
+            skip_spaces(&p, end);
+            if (p < end && *p == ')') break;
+            if (p >= end || *p++ != '.' || !parse_identifier(&p, end, &port)) { why = "expected .PORT(net)"; break; }
+            skip_spaces(&p, end);
+            if (p >= end || *p++ != '(' || !(p = check_connection(p, end, &net))) { why = "bad connection"; break; }
+            int bit = -1;
+            if (port.len == 2 && port.s[0] == 'I' && port.s[1] >= '0' && port.s[1] <= '5') bit = port.s[1] - '0';
+            else if (port.len == 1 && port.s[0] == 'Z') bit = 6;
+            else if (port.len == 2 && port.s[0] == 'Z' && port.s[1] == '5') bit = 7;
+            if (bit < 0) why = "unknown port";
+            else if (seen & (1u << bit)) why = "port connected twice";
+            else if (bit < 6 && !isdigit((unsigned char)net.s[0]) && net.s[0] != '\'' &&
+                     net_lookup(&nl->nets, net.s, net.len) == NET_ID_PAD) why = "input net not in the source";
+            if (why) break;
+            seen |= 1u << bit;
+            skip_spaces(&p, end);
+            if (p < end && *p == ',') p++;
+        }
+        if (!why && p < end) p++;
+        if (!why) skip_spaces(&p, end);
+        if (!why && (p >= end || *p != ';')) why = "no ';' after the port list";
+        if (!why && seen != 0xFF) why = "not all of I0..I5, Z, Z5 connected";
+        if (why) {
+            if (errors++ < 5) {
+                int line = 1;
+                for (const char *c = buf; c < at; c++) line += *c == '\n';
+                printf("  %s:%d: GTP_LUT6D: %s\n", path, line, why);
+            }
+            p = skip_statement(at + 9, end);
+        }
+    }
+    if (cells != merged && errors++ < 5) printf("  %s: %d GTP_LUT6D cells, %d merged\n", path, cells, merged);
+
+    Options plain;
+    lutpair_options_init(&plain);
+    Netlist re;
+    RunTimes t = {0};
+    if (!load_netlist(path, &plain, &re, NULL, &t)) {
+        if (errors++ < 5) printf("  %s: cannot parse\n", path);
+    } else {
+        if (re.n_luts != nl->n_luts - 2 * merged && errors++ < 5)
+            printf("  %s: %d GTP_LUT cells left, expected %d\n", path, re.n_luts, nl->n_luts - 2 * merged);
+        netlist_free(&re);
+    }
+    free(buf);
+    return errors;
+}
+
+static int regress_check(const Job *job) {
+    // The check loads the netlist as written: no pruning, no cache. The
+    // pairs are then merged with --netlist and the result read back.
+    char res_path[256], net_path[256];
+    snprintf(res_path, sizeof(res_path), "design_%d_syn.res", job->idx);
+    snprintf(net_path, sizeof(net_path), "design_%d_syn_lut6d.v", job->idx);
+    Options plain;
+    lutpair_options_init(&plain);
+    plain.netlist = 1;
+    Netlist nl;
+    RunTimes t = {0};
+    if (!load_netlist(job->path, &plain, &nl, NULL, &t)) return 1;
+    int *pa = (int*)xmalloc(((size_t)nl.n_luts / 2 + 1) * sizeof(int));
+    int *pb = (int*)xmalloc(((size_t)nl.n_luts / 2 + 1) * sizeof(int));
+    int n_valid;
+    NetlistStats ns;
+    int bad = check_res(res_path, &nl, pa, pb, &n_valid);
+    if (!write_netlist(net_path, &nl, pa, pb, n_valid, &ns)) {
+        printf("  %s: cannot write\n", net_path);
+        bad++;
+    } else {
+        bad += check_netlist(net_path, &nl, ns.merged);
+    }
+    free(pa);
+    free(pb);
+    netlist_free(&nl);
+    return bad;
+}
+
+static void regress_run(const Job *job, const Options *opt, int reps, int check, RegressRun *out) {
+    // Measures, then checks the .res the last run wrote (when `check`); in a
+    // child process so each case's peak RSS is its own and the check's
+    // allocations do not carry over into the next case.
+    out->luts = -1;
+    out->bad = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    int fd[2];
+    fflush(stdout);
+    fflush(stderr);
+    if (pipe(fd) == 0) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fd[0]);
+            regress_measure(job, opt, reps, out);
+            if (check && out->luts >= 0) {
+                out->bad = regress_check(job);
+                fflush(stdout);
+            }
+            ssize_t w = write(fd[1], out, sizeof(*out));
+            _exit(w == (ssize_t)sizeof(*out) ? 0 : 1);
+        }
+        close(fd[1]);
+        if (pid > 0) {
+            if (read(fd[0], out, sizeof(*out)) != (ssize_t)sizeof(*out)) out->luts = -1;
+            waitpid(pid, NULL, 0);
+        }
+        close(fd[0]);
+        if (pid > 0) return;
+    }
+#endif
+    regress_measure(job, opt, reps, out);
+    if (check && out->luts >= 0) out->bad = regress_check(job);
+}
+
+static int load_regress_baseline(const char *path, RegressBase **out, int *n_out) {
+    // Header line names the columns; file, strategy, pairs and luts_per_s
+    // are used, and host_mops when present. Returns 0 if the file cannot be
+    // read.
+    *out = NULL;
+    *n_out = 0;
+    long len = 0;
+    char *buf = read_entire_file(path, &len);
+    if (!buf) return 0;
+    int col_file = -1, col_strat = -1, col_pairs = -1, col_rate = -1, col_host = -1, cap = 0;
+    char *save = NULL;
+    for (char *ln = strtok_r(buf, "\n", &save); ln; ln = strtok_r(NULL, "\n", &save)) {
+        char *field[32];
+        int n = 0;
+        for (char *f = ln; n < 32; ) {
+            field[n++] = f;
+            char *c = strchr(f, ',');
+            if (!c) break;
+            *c = '\0';
+            f = c + 1;
+        }
+        if (n > 0) {
+            size_t l = strlen(field[n - 1]);
+            if (l && field[n - 1][l - 1] == '\r') field[n - 1][l - 1] = '\0';
+        }
+        if (col_file < 0) {
+            for (int k = 0; k < n; k++) {
+                if (strcmp(field[k], "file") == 0) col_file = k;
+                else if (strcmp(field[k], "strategy") == 0) col_strat = k;
+                else if (strcmp(field[k], "pairs") == 0) col_pairs = k;
+                else if (strcmp(field[k], "luts_per_s") == 0) col_rate = k;
+                else if (strcmp(field[k], "host_mops") == 0) col_host = k;
+            }
+            if (col_file < 0 || col_strat < 0 || col_pairs < 0 || col_rate < 0) break;
+            continue;
+        }
+        if (n <= col_file || n <= col_strat || n <= col_pairs || n <= col_rate) continue;
+        if (*n_out == cap) {
+            cap = cap ? cap * 2 : 32;
+            *out = (RegressBase*)xrealloc(*out, (size_t)cap * sizeof(RegressBase));
+        }
+        RegressBase *b = &(*out)[(*n_out)++];
+        snprintf(b->file, sizeof(b->file), "%s", field[col_file]);
+        snprintf(b->strategy, sizeof(b->strategy), "%s", field[col_strat]);
+        b->pairs = atoi(field[col_pairs]);
+        b->luts_per_s = atof(field[col_rate]);
+        b->host_mops = col_host >= 0 && n > col_host ? atof(field[col_host]) : 0.0;
+    }
+    free(buf);
+    if (col_rate < 0) fprintf(stderr, "%s: missing file/strategy/pairs/luts_per_s columns\n", path);
+    return col_rate >= 0;
+}
+
+// Host speed, measured next to every case: the best of a few
+// passes of hashing (net_mix) and scattered reads and writes over a table
+// the size of a testcase's working set. Throughput is compared in units of
+// this rate, so a host that is uniformly slower today (another VM, a
+// lower clock) does not fail every case, while one strategy getting slower
+// than the rest still does.
+#define CALIB_WORDS (1u << 21)
+
+static volatile uint64_t calib_sink;   // keeps the loop from being optimized out
+
+static double regress_calibrate(void) {
+    // Mapped directly, so the table is gone before the next case forks and
+    // does not count towards its peak RSS.
+#if defined(__unix__) || defined(__APPLE__)
+    void *m = mmap(NULL, CALIB_WORDS * sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    uint64_t *t = m == MAP_FAILED ? NULL : (uint64_t*)m;
+#else
+    uint64_t *t = (uint64_t*)calloc(CALIB_WORDS, sizeof(uint64_t));
+#endif
+    if (!t) { fprintf(stderr, "OOM\n"); exit(1); }
+    double best = 0;
+    uint64_t x = 0;
+    for (int pass = 0; pass < 3; pass++) {
+        double t0 = now_seconds();
+        for (uint32_t k = 0; k < 4 * CALIB_WORDS; k++) {
+            x = net_mix((uint32_t)x ^ k);
+            t[x & (CALIB_WORDS - 1)] += x;
+        }
+        double dt = now_seconds() - t0;
+        if (pass == 0 || dt < best) best = dt;
+    }
+    calib_sink = x ^ t[x & (CALIB_WORDS - 1)];
+#if defined(__unix__) || defined(__APPLE__)
+    munmap(t, CALIB_WORDS * sizeof(uint64_t));
+#else
+    free(t);
+#endif
+    return 4.0 * CALIB_WORDS / best / 1e6; // Mops/s
+}
+
+static const char *path_basename(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// lutpair gen: a synthetic netlist in the layout of the design_*_syn.v
+// testcases, for scaling runs well past design_3. Each LUT drives a net of
+// its own; each input is, with probability `share`, one of the last
+// GEN_WINDOW nets created (local logic, heavy input sharing) and otherwise
+// any earlier net or primary input. Widths follow a design_1-like mix.
+#define GEN_WINDOW 48
+
+static uint64_t gen_next(uint64_t *s) {
+    // xorshift64*
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1Dull;
+}
+
+static void out_net(OutBuf *o, uint32_t id) {
+    out_str(o, "net_");
+    out_u64(o, id);
+}
+
+static int gen_netlist(const char *path, int n_luts, double share, uint64_t seed) {
+    static const int width_pct[LUT_MAX_INPUTS] = { 1, 4, 8, 10, 12, 65 };  // LUT1..LUT6
+    uint32_t n_pi = (uint32_t)(n_luts / 20 + 16);
+    uint64_t st = seed * 0x9E3779B97F4A7C15ull + 1;
+    OutBuf o;
+    if (!out_open(&o, path)) return 0;
+    out_str(&o, "/* lutpair gen */\n\nmodule synth(");
+    for (uint32_t k = 0; k < n_pi; k++) {
+        if (k) out_str(&o, k % 16 ? ", " : ",\n  ");
+        out_net(&o, k);
+    }
+    out_str(&o, ");\n");
+    for (uint32_t k = 0; k < n_pi; k++) {
+        out_str(&o, "  input ");
+        out_net(&o, k);
+        out_str(&o, ";\n");
+    }
+    for (int k = 0; k < n_luts; k++) {
+        out_str(&o, "  wire ");
+        out_net(&o, n_pi + (uint32_t)k);
+        out_str(&o, ";\n");
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    for (int k = 0; k < n_luts; k++) {
+        uint32_t n_avail = n_pi + (uint32_t)k;
+        int pct = (int)(gen_next(&st) % 100), w = 1;
+        for (int acc = width_pct[0]; w < LUT_MAX_INPUTS && pct >= acc; acc += width_pct[w++]) {}
+        uint32_t in[LUT_MAX_INPUTS];
+        for (int i = 0; i < w; i++) {
+            for (;;) {
+                uint64_t r = gen_next(&st);
+                int local = (double)(r >> 11) * (1.0 / 9007199254740992.0) < share;
+                uint32_t win = n_avail < GEN_WINDOW ? n_avail : GEN_WINDOW;
+                uint64_t r2 = gen_next(&st);
+                in[i] = local ? n_avail - 1 - (uint32_t)(r2 % win) : (uint32_t)(r2 % n_avail);
+                int dup = 0;
+                for (int q = 0; q < i; q++) dup |= in[q] == in[i];
+                if (!dup || n_avail <= (uint32_t)i) break;
+            }
+        }
+        int bits = 1 << w;
+        uint64_t init = gen_next(&st);
+        if (bits < 64) init &= (1ull << bits) - 1;
+        char lit[24];
+        int nd = bits >= 4 ? bits / 4 : 1;
+        int p = snprintf(lit, sizeof(lit), "%d'h", bits);
+        for (int d = 0; d < nd; d++) lit[p + d] = hex[(init >> (4 * (nd - 1 - d))) & 15];
+        lit[p + nd] = 0;
+
+        out_str(&o, "  GTP_LUT");
+        out_u64(&o, (uint64_t)w);
+        out_str(&o, " #(\n    .INIT(");
+        out_str(&o, lit);
+        out_str(&o, ")\n  ) cell_");
+        out_u64(&o, (uint64_t)k);
+        out_str(&o, "_lut (\n");
+        for (int i = 0; i < w; i++) {
+            out_str(&o, "    .I");
+            out_u64(&o, (uint64_t)i);
+            out_put(&o, "(", 1);
+            out_net(&o, in[i]);
+            out_str(&o, "),\n");
+        }
+        out_str(&o, "    .Z(");
+        out_net(&o, n_avail);
+        out_str(&o, ")\n  );\n");
+    }
+    out_str(&o, "endmodule\n");
+    return out_close(&o);
+}
+
+int lutpair_gen(int argc, char **argv) {
+    // lutpair gen [--scale=X | --luts=N] [--share=P] [--seed=S] OUT.v
+    double scale = 10.0, share = 0.5;
+    int n_luts = 0;
+    uint64_t seed = 1;
+    const char *out = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--scale=", 8) == 0) scale = atof(argv[i] + 8);
+        else if (strncmp(argv[i], "--luts=", 7) == 0) n_luts = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--share=", 8) == 0) share = atof(argv[i] + 8);
+        else if (strncmp(argv[i], "--seed=", 7) == 0) seed = strtoull(argv[i] + 7, NULL, 10);
+        else if (argv[i][0] == '-') { fprintf(stderr, "Unknown option: %s\n", argv[i]); return 1; }
+        else out = argv[i];
+    }
+    if (!out) {
+        fprintf(stderr, "usage: lutpair gen [--scale=X | --luts=N] [--share=P] [--seed=S] OUT.v\n");
+        return 1;
+    }
+    if (n_luts <= 0) n_luts = (int)(scale * 25460);  // design_3 has 25460 LUTs
+    if (n_luts < 1) n_luts = 1;
+    double t0 = now_seconds();
+    if (!gen_netlist(out, n_luts, share, seed)) {
+        fprintf(stderr, "Failed to write %s\n", out);
+        return 1;
+    }
+    printf("%s: LUTs=%d share=%.2f seed=%llu %.3f s\n", out, n_luts, share,
+           (unsigned long long)seed, now_seconds() - t0);
+    return 0;
+}
+
+// Options that only steer pairing, so they can differ per query against an
+// already loaded netlist (see serve). Returns 1 if `arg` was one, 0 if not,
+// -1 for a bad value; the caller reports it.
+static int parse_pair_option(Options *opt, const char *arg) {
+    if (strncmp(arg, "--strategy=", 11) == 0) {
+        const char *name = arg + 11;
+        opt->strategy = strcmp(name, "all") == 0 ? LUTPAIR_STRATEGY_ALL : lutpair_find_strategy(name);
+        opt->report = 1;
+        if (opt->strategy == -1 && strcmp(name, "all") != 0) return -1;
+        for (int k = 0; k < N_STRATEGIES; k++) {
+            if (strategies[k].needs_netgraph && (opt->strategy == k || opt->strategy == LUTPAIR_STRATEGY_ALL))
+                opt->graph = 1;
+        }
+    } else if (strcmp(arg, "--matcher=greedy") == 0) {
+        opt->matcher = LUTPAIR_MATCHER_GREEDY;
+    } else if (strcmp(arg, "--matcher=blossom") == 0) {
+        opt->matcher = LUTPAIR_MATCHER_BLOSSOM;
+    } else if (strcmp(arg, "--matcher=exact") == 0) {
+        opt->matcher = LUTPAIR_MATCHER_EXACT;
+    } else if (strcmp(arg, "--export-graph") == 0) {
+        opt->export_graph = 1;
+    } else if (strncmp(arg, "--budget-ms=", 12) == 0) {
+        opt->budget_ms = atoi(arg + 12);
+    } else if (strncmp(arg, "--time-limit=", 13) == 0) {
+        opt->time_limit_ms = atoi(arg + 13);
+        if (opt->time_limit_ms < 0) opt->time_limit_ms = 0;
+    } else if (strncmp(arg, "--free-edges=", 13) == 0) {
+        opt->free_edges = atoi(arg + 13);
+        if (opt->free_edges < 0) opt->free_edges = 0;
+        if (opt->free_edges > GRAPH_MAX_FREE_EDGES) opt->free_edges = GRAPH_MAX_FREE_EDGES;
+    } else if (strncmp(arg, "--incremental=", 14) == 0) {
+        opt->incremental = arg + 14;
+    } else if (strncmp(arg, "-j", 2) == 0 && isdigit((unsigned char)arg[2])) {
+        opt->threads = atoi(arg + 2);
+        if (opt->threads < 1) opt->threads = 1;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+void lutpair_options_init(lutpair_options *opt) {
+    memset(opt, 0, sizeof(*opt));
+    opt->strategy = lutpair_find_strategy("first-fit");
+    opt->matcher = LUTPAIR_MATCHER_GREEDY;
+    opt->budget_ms = 10000;
+    opt->free_edges = 8;
+    opt->threads = 1;
+}
+
+int lutpair_parse_option(lutpair_options *opt, const char *arg) {
+    if (strcmp(arg, "--stream") == 0) {
+        opt->stream = 1;
+    } else if (strcmp(arg, "--netlist") == 0) {
+        opt->netlist = 1;
+    } else if (strcmp(arg, "--stats=json") == 0) {
+        opt->stats = 1;
+    } else if (strcmp(arg, "--cache") == 0) {
+        opt->cache = 1;
+    } else if (strcmp(arg, "--compact") == 0) {
+        opt->compact = 1;
+    } else if (strcmp(arg, "--graph") == 0) {
+        opt->graph = 1;
+    } else if (strcmp(arg, "--prune-inputs") == 0) {
+        opt->prune = 1;
+    } else if (strcmp(arg, "--preserve-depth") == 0) {
+        opt->preserve_depth = 1;
+        opt->graph = 1;
+    } else {
+        return parse_pair_option(opt, arg);
+    }
+    return 1;
+}
+
+// Server mode: `lutpair serve SOCKET [options] [design_x.v ...]` loads each
+// netlist once (prepare_netlist, the same path as a single run, with the
+// load options given on the command line) and answers queries on a Unix
+// socket, one request line per connection:
+//   pair design_x.v [--strategy=S] [--matcher=M] [--budget-ms=N]
+//        [--time-limit=MS] [--free-edges=K] [--incremental=P] [-jN]
+//        [--export-graph] [--out=PATH]
+//   load design_x.v | unload design_x.v | list | shutdown
+// The reply is the run's log followed by one "ok ..." or "error ..." line.
+// -j N sets the number of workers; each accepts and serves connections on
+// its own, and -jN in a query sets that query's graph threads (default 1).
+// Loaded designs (LUT records, names, net table, fanout index, net graph)
+// are shared read-only by all queries. The one per-query copy is the Lut
+// array itself, because every strategy marks used LUTs in place. A design
+// whose file changed on disk is loaded again on its next query; the old
+// copy is freed when its last query finishes.
+#if defined(LUTPAIR_THREADS) && defined(LUTPAIR_SOCKETS)
+#define SERVE_MAX_REQUEST 65536
+#define SERVE_MAX_ARGS 64
+
+enum { DESIGN_LOADING, DESIGN_READY, DESIGN_FAILED };
+
+typedef struct Design {
+    char *path;
+    int idx;
+    long long size;
+    long long mtime;
+    int state;          // DESIGN_*
+    int stale;          // replaced by a newer load, or unloaded
+    int refs;           // queries using it, plus one while listed
+    double load_s;
+    Netlist nl;
+    FanoutIndex fx;
+    StrBuf log;         // load log, replayed to the query that loaded it
+    struct Design *next;
+} Design;
+
+typedef struct {
+    int fd;             // listening socket
+    const char *sock_path;
+    Options opt;        // load options and per-query defaults
+    Design *designs;
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t loaded;
+} Server;
+
+static void design_free(Design *d) {
+    if (d->state == DESIGN_READY) {
+        free_fanout_index(&d->fx);
+        netlist_free(&d->nl);
+    }
+    free(d->log.s);
+    free(d->path);
+    free(d);
+}
+
+static void server_unlink(Server *sv, Design *d) {
+    for (Design **p = &sv->designs; *p; p = &(*p)->next) {
+        if (*p == d) {
+            *p = d->next;
+            return;
+        }
+    }
+}
+
+static void server_release(Server *sv, Design *d) {
+    pthread_mutex_lock(&sv->lock);
+    int last = --d->refs == 0;
+    if (last) server_unlink(sv, d);
+    pthread_mutex_unlock(&sv->lock);
+    if (last) design_free(d);
+}
+
+static void server_retire(Server *sv, Design *d) {
+    // Lock held. Drops the list's reference; queries still running keep it.
+    d->stale = 1;
+    if (--d->refs == 0) {
+        server_unlink(sv, d);
+        design_free(d);
+    }
+}
+
+// Returns the loaded design with a reference held, loading it first if no
+// current copy is listed, or NULL (reason in `err`).
+static Design *server_acquire(Server *sv, const char *path, int *was_loaded, char *err, size_t err_len) {
+    struct stat st;
+    int idx = -1;
+    if (stat(path, &st) != 0) {
+        snprintf(err, err_len, "cannot stat %s", path);
+        return NULL;
+    }
+    if (!match_design_v(path, &idx)) idx = -1;
+    pthread_mutex_lock(&sv->lock);
+    Design *d = sv->designs;
+    while (d) {
+        Design *next = d->next;
+        if (!d->stale && strcmp(d->path, path) == 0) {
+            if (d->state != DESIGN_READY || (d->size == (long long)st.st_size &&
+                                             d->mtime == (long long)st.st_mtime)) break;
+            server_retire(sv, d);
+        }
+        d = next;
+    }
+    *was_loaded = 0;
+    if (d) {
+        d->refs++;
+        while (d->state == DESIGN_LOADING) pthread_cond_wait(&sv->loaded, &sv->lock);
+        pthread_mutex_unlock(&sv->lock);
+    } else {
+        d = (Design*)calloc(1, sizeof(Design));
+        if (!d) { fprintf(stderr, "OOM\n"); exit(1); }
+        d->path = (char*)xmalloc(strlen(path) + 1);
+        strcpy(d->path, path);
+        d->idx = idx;
+        d->size = (long long)st.st_size;
+        d->mtime = (long long)st.st_mtime;
+        d->state = DESIGN_LOADING;
+        d->refs = 2;
+        d->next = sv->designs;
+        sv->designs = d;
+        pthread_mutex_unlock(&sv->lock);
+
+        double t0 = now_seconds();
+        RunTimes times = {0};
+        int ok = prepare_netlist(path, &sv->opt, &d->nl, &d->fx, &d->log, &times);
+        d->load_s = now_seconds() - t0;
+        *was_loaded = 1;
+
+        pthread_mutex_lock(&sv->lock);
+        d->state = ok ? DESIGN_READY : DESIGN_FAILED;
+        if (!ok) server_retire(sv, d);
+        pthread_cond_broadcast(&sv->loaded);
+        pthread_mutex_unlock(&sv->lock);
+    }
+    if (d->state != DESIGN_READY) {
+        snprintf(err, err_len, "cannot read %s", path);
+        server_release(sv, d);
+        return NULL;
+    }
+    return d;
+}
+
+static int send_all(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return 0;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 1;
+}
+
+static void serve_pair(Server *sv, char **args, int n_args, StrBuf *out) {
+    Options opt = sv->opt;
+    opt.threads = 1;
+    const char *path = NULL, *res = NULL;
+    for (int k = 0; k < n_args; k++) {
+        int r = parse_pair_option(&opt, args[k]);
+        if (r < 0) {
+            sb_printf(out, "error bad value: %s\n", args[k]);
+            return;
+        }
+        if (r > 0) continue;
+        if (strncmp(args[k], "--out=", 6) == 0) {
+            res = args[k] + 6;
+        } else if (args[k][0] == '-' || path) {
+            sb_printf(out, "error unsupported in a query: %s\n", args[k]);
+            return;
+        } else {
+            path = args[k];
+        }
+    }
+    if (!path) {
+        sb_printf(out, "error pair needs a design\n");
+        return;
+    }
+    for (int k = 0; k < N_STRATEGIES; k++) {
+        if (strategies[k].needs_netgraph && !sv->opt.graph && (opt.strategy == k || opt.strategy == LUTPAIR_STRATEGY_ALL)) {
+            sb_printf(out, "error strategy %s needs a server started with --graph\n", strategies[k].name);
+            return;
+        }
+    }
+
+    double t0 = now_seconds();
+    char err[1100];
+    int was_loaded;
+    Design *d = server_acquire(sv, path, &was_loaded, err, sizeof(err));
+    if (!d) {
+        sb_printf(out, "error %s\n", err);
+        return;
+    }
+    char outfile[1024];
+    if (res) snprintf(outfile, sizeof(outfile), "%s", res);
+    else if (d->idx >= 0) snprintf(outfile, sizeof(outfile), "design_%d_syn.res", d->idx);
+    else {
+        sb_printf(out, "error %s is not design_*.v; give --out=\n", path);
+        server_release(sv, d);
+        return;
+    }
+    if (was_loaded && d->log.len) sb_printf(out, "%.*s", (int)d->log.len, d->log.s);
+
+    int n_luts = d->nl.n_luts;
+    Lut *work = (Lut*)xmalloc((size_t)n_luts * sizeof(Lut) + 1);
+    memcpy(work, d->nl.luts, (size_t)n_luts * sizeof(Lut));
+    RunTimes times = {0};
+    double tp = now_seconds();
+    int n_pairs = pair_netlist(path, d->idx, &d->nl, work, &d->fx, &opt, outfile, tp, out, &times);
+    free(work);
+    double t_end = now_seconds();
+    sb_printf(out, "ok pairs=%d luts=%d load=%s%.3f ms pair=%.3f ms total=%.3f ms -> %s\n", n_pairs, n_luts,
+              was_loaded ? "" : "cached ", d->load_s * 1e3, (t_end - tp) * 1e3, (t_end - t0) * 1e3, outfile);
+    server_release(sv, d);
+}
+
+static void serve_request(Server *sv, char *line, StrBuf *out) {
+    char *args[SERVE_MAX_ARGS];
+    int n_args = 0;
+    for (char *tok = strtok(line, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+        if (n_args == SERVE_MAX_ARGS) {
+            sb_printf(out, "error too many arguments\n");
+            return;
+        }
+        args[n_args++] = tok;
+    }
+    if (n_args == 0) {
+        sb_printf(out, "error empty request\n");
+    } else if (strcmp(args[0], "pair") == 0) {
+        serve_pair(sv, args + 1, n_args - 1, out);
+    } else if (strcmp(args[0], "load") == 0 && n_args == 2) {
+        char err[1100];
+        int was_loaded;
+        Design *d = server_acquire(sv, args[1], &was_loaded, err, sizeof(err));
+        if (!d) {
+            sb_printf(out, "error %s\n", err);
+            return;
+        }
+        if (was_loaded && d->log.len) sb_printf(out, "%.*s", (int)d->log.len, d->log.s);
+        sb_printf(out, "ok %s LUTs=%d load=%s%.3f ms\n", d->path, d->nl.n_luts, was_loaded ? "" : "cached ",
+                  d->load_s * 1e3);
+        server_release(sv, d);
+    } else if (strcmp(args[0], "unload") == 0 && n_args == 2) {
+        int found = 0;
+        pthread_mutex_lock(&sv->lock);
+        for (Design *d = sv->designs, *next; d; d = next) {
+            next = d->next;
+            if (!d->stale && d->state == DESIGN_READY && strcmp(d->path, args[1]) == 0) {
+                server_retire(sv, d);
+                found = 1;
+            }
+        }
+        pthread_mutex_unlock(&sv->lock);
+        if (found) sb_printf(out, "ok unloaded %s\n", args[1]);
+        else sb_printf(out, "error %s is not loaded\n", args[1]);
+    } else if (strcmp(args[0], "list") == 0 && n_args == 1) {
+        int n = 0;
+        pthread_mutex_lock(&sv->lock);
+        for (Design *d = sv->designs; d; d = d->next) {
+            if (d->stale || d->state != DESIGN_READY) continue;
+            sb_printf(out, "%s LUTs=%d queries=%d load=%.3f ms\n", d->path, d->nl.n_luts, d->refs - 1,
+                      d->load_s * 1e3);
+            n++;
+        }
+        pthread_mutex_unlock(&sv->lock);
+        sb_printf(out, "ok %d designs\n", n);
+    } else if (strcmp(args[0], "shutdown") == 0 && n_args == 1) {
+        pthread_mutex_lock(&sv->lock);
+        sv->stop = 1;
+        pthread_mutex_unlock(&sv->lock);
+        // Wakes the workers blocked in accept().
+        shutdown(sv->fd, SHUT_RDWR);
+        sb_printf(out, "ok shutting down\n");
+    } else {
+        sb_printf(out, "error unknown request: %s\n", args[0]);
+    }
+}
+
+static void serve_worker(void *arg, int tid, int n_threads) {
+    (void)tid;
+    (void)n_threads;
+    Server *sv = (Server*)arg;
+    char *line = (char*)xmalloc(SERVE_MAX_REQUEST + 1);
+    for (;;) {
+        int c = accept(sv->fd, NULL, NULL);
+        pthread_mutex_lock(&sv->lock);
+        int stop = sv->stop;
+        pthread_mutex_unlock(&sv->lock);
+        if (c < 0) {
+            if (stop || (errno != EINTR && errno != ECONNABORTED)) break;
+            continue;
+        }
+        size_t len = 0;
+        while (len < SERVE_MAX_REQUEST && !memchr(line, '\n', len)) {
+            ssize_t n = read(c, line + len, SERVE_MAX_REQUEST - len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            len += (size_t)n;
+        }
+        line[len] = '\0';
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        StrBuf out = {0};
+        serve_request(sv, line, &out);
+        if (out.len) send_all(c, out.s, out.len);
+        free(out.s);
+        close(c);
+        if (stop) break;
+    }
+    free(line);
+}
+
+static int serve_jobs(const char *sock_path, Job *jobs, int n_jobs, const Options *opt) {
+    Server sv;
+    memset(&sv, 0, sizeof(sv));
+    sv.opt = *opt;
+    sv.sock_path = sock_path;
+    pthread_mutex_init(&sv.lock, NULL);
+    pthread_cond_init(&sv.loaded, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(sock_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", sock_path);
+        return 1;
+    }
+    strcpy(addr.sun_path, sock_path);
+    sv.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(sock_path);
+    if (sv.fd < 0 || bind(sv.fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(sv.fd, 64) != 0) {
+        fprintf(stderr, "Cannot listen on %s: %s\n", sock_path, strerror(errno));
+        if (sv.fd >= 0) close(sv.fd);
+        return 1;
+    }
+
+    for (int k = 0; k < n_jobs; k++) {
+        char err[1100];
+        int was_loaded;
+        Design *d = server_acquire(&sv, jobs[k].path, &was_loaded, err, sizeof(err));
+        if (!d) {
+            fprintf(stderr, "%s\n", err);
+            continue;
+        }
+        printf("loaded %s: LUTs=%d %.3f ms\n", d->path, d->nl.n_luts, d->load_s * 1e3);
+        server_release(&sv, d);
+    }
+    printf("serving on %s with %d workers\n", sock_path, opt->threads);
+    fflush(stdout);
+
+    parallel_run(opt->threads, serve_worker, &sv);
+
+    close(sv.fd);
+    unlink(sock_path);
+    while (sv.designs) {
+        Design *d = sv.designs;
+        sv.designs = d->next;
+        design_free(d);
+    }
+    pthread_cond_destroy(&sv.loaded);
+    pthread_mutex_destroy(&sv.lock);
+    return 0;
+}
+
+// `lutpair client SOCKET REQUEST...`: send one request, print the reply,
+// exit 0 if it ends in "ok".
+int lutpair_client(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: lutpair client SOCKET REQUEST...\n");
+        return 2;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", argv[1]);
+        return 2;
+    }
+    strcpy(addr.sun_path, argv[1]);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "Cannot connect to %s: %s\n", argv[1], strerror(errno));
+        if (fd >= 0) close(fd);
+        return 2;
+    }
+    StrBuf req = {0};
+    for (int k = 2; k < argc; k++) sb_printf(&req, "%s%s", k > 2 ? " " : "", argv[k]);
+    sb_printf(&req, "\n");
+    int ok = send_all(fd, req.s, req.len);
+    free(req.s);
+    StrBuf reply = {0};
+    char buf[4096];
+    ssize_t n;
+    while (ok && (n = read(fd, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        sb_printf(&reply, "%.*s", (int)n, buf);
+    }
+    close(fd);
+    if (reply.len) fwrite(reply.s, 1, reply.len, stdout);
+    // Status is the last line of the reply.
+    size_t last = reply.len;
+    while (last > 0 && reply.s[last - 1] == '\n') last--;
+    while (last > 0 && reply.s[last - 1] != '\n') last--;
+    int status = reply.len && strncmp(reply.s + last, "ok", 2) == 0 ? 0 : 1;
+    free(reply.s);
+    return status;
+}
+#else
+int lutpair_client(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    fprintf(stderr, "client needs Unix sockets and threads\n");
+    return 1;
+}
+#endif
+
+// Command-line drivers. Paths that are not design_*.v (or "-") are skipped,
+// as before; with none given the current directory is scanned.
+static int collect_jobs(char *const *paths, int n_paths, int scan, Job **jobs, int *n_jobs) {
+    int cap = 0;
+    *jobs = NULL;
+    *n_jobs = 0;
+    if (n_paths == 0) return scan ? scan_design_dir(jobs, n_jobs, &cap) : 0;
+    for (int i = 0; i < n_paths; i++) {
+        int idx = -1;
+        if (strcmp(paths[i], "-") != 0 && !match_design_v(paths[i], &idx)) {
+            fprintf(stderr, "Skipping (not design_*.v): %s\n", paths[i]);
+            continue;
+        }
+        // design_<n>.v and design_<n>_syn.v both write design_<n>_syn.res.
+        int dup = -1;
+        for (int k = 0; k < *n_jobs && dup < 0; k++) {
+            if ((*jobs)[k].idx == idx) dup = k;
+        }
+        if (dup >= 0) {
+            fprintf(stderr, "Skipping %s (same index as %s)\n", paths[i], (*jobs)[dup].path);
+            continue;
+        }
+        add_job(jobs, n_jobs, &cap, paths[i], idx);
+    }
+    return 0;
+}
+
+static void free_jobs(Job *jobs, int n_jobs) {
+    for (int k = 0; k < n_jobs; k++) {
+        free(jobs[k].path);
+        free(jobs[k].log.s);
+    }
+    free(jobs);
+}
+
+int lutpair_run(char *const *paths, int n_paths, const lutpair_options *opt) {
+    Job *jobs;
+    int n_jobs;
+    if (collect_jobs(paths, n_paths, 1, &jobs, &n_jobs) != 0) return 1;
+    run_batch(jobs, n_jobs, opt);
+    free_jobs(jobs, n_jobs);
+    return 0;
+}
+
+int lutpair_bench(char *const *paths, int n_paths, const lutpair_options *opt, int reps, int layout) {
+    Job *jobs;
+    int n_jobs;
+    if (collect_jobs(paths, n_paths, 1, &jobs, &n_jobs) != 0) return 1;
+    if (layout) run_layout_bench(jobs, n_jobs, opt, reps);
+    else run_bench(jobs, n_jobs, opt, reps);
+    free_jobs(jobs, n_jobs);
+    return 0;
+}
+
+int lutpair_regress(char *const *paths, int n_paths, const lutpair_options *opt, int reps,
+                    const char *baseline, const char *csv_path, double tolerance) {
+    Job *jobs;
+    int n_jobs;
+    if (collect_jobs(paths, n_paths, 1, &jobs, &n_jobs) != 0) return 1;
+    RegressBase *base = NULL;
+    int n_base = 0;
+    if (baseline && !load_regress_baseline(baseline, &base, &n_base)) {
+        fprintf(stderr, "Cannot read baseline %s\n", baseline);
+        free_jobs(jobs, n_jobs);
+        return 1;
+    }
+    FILE *csv = fopen(csv_path, "w");
+    if (!csv) {
+        fprintf(stderr, "Cannot write %s\n", csv_path);
+        free(base);
+        free_jobs(jobs, n_jobs);
+        return 1;
+    }
+    fprintf(csv, "file,strategy,luts,pairs,read_ms,parse_ms,index_ms,match_ms,write_ms,total_ms,"
+                 "luts_per_s,rss_mb,res_ok,host_mops\n");
+
+    int n_cases = 0, n_failed = 0;
+    for (int j = 0; j < n_jobs; j++) {
+        const Job *job = &jobs[j];
+        const char *file = path_basename(job->path);
+        for (int k = 0; k < N_STRATEGIES; k++) {
+            Options o = *opt;
+            o.strategy = k;
+            o.report = 0;
+            o.stats = 0;
+            o.time_limit_ms = 0;
+            o.incremental = NULL;
+            if (strategies[k].needs_netgraph) o.graph = 1;
+            RegressRun run;
+            double host = regress_calibrate();
+            regress_run(job, &o, reps, 1, &run);
+            host = (host + regress_calibrate()) / 2;
+            n_cases++;
+            if (run.luts < 0) {
+                printf("regress %s %s: run failed\n", file, strategies[k].name);
+                n_failed++;
+                continue;
+            }
+
+            int bad = run.bad;
+            const RegressBase *b = NULL;
+            for (int q = 0; q < n_base && !b; q++) {
+                if (strcmp(base[q].file, file) == 0 && strcmp(base[q].strategy, strategies[k].name) == 0)
+                    b = &base[q];
+            }
+            // Relative to the baseline, in host-speed units when both sides
+            // have them (calibrated either side of the case). A slow verdict gets one more round (and a fresh
+            // calibration) first: a busy host easily costs a whole round.
+            double rate = run.total > 0 ? run.luts / run.total : 0.0, change = 0.0;
+            for (int attempt = 0; b && b->luts_per_s > 0; attempt++) {
+                double scale = b->host_mops > 0 && host > 0 ? b->host_mops / host : 1.0;
+                change = (rate * scale / b->luts_per_s - 1.0) * 100.0;
+                if (change >= -tolerance || attempt == 1) break;
+                RegressRun again;
+                double host_again = regress_calibrate();
+                regress_run(job, &o, reps, 0, &again);
+                host_again = (host_again + regress_calibrate()) / 2;
+                if (again.luts >= 0 && again.total > 0 &&
+                    (double)again.luts / again.total / host_again > rate / host) {
+                    run.total = again.total;
+                    rate = run.luts / run.total;
+                    host = host_again;
+                }
+            }
+            fprintf(csv, "%s,%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.0f,%.1f,%d,%.1f\n", file,
+                    strategies[k].name, run.luts, run.pairs, run.read * 1e3, run.parse * 1e3,
+                    run.index * 1e3, run.match * 1e3, run.write * 1e3, run.total * 1e3, rate,
+                    run.rss_mb, !bad, host);
+
+            int failed = bad != 0;
+            printf("regress %-16s %-11s pairs=%-6d %9.0f LUTs/s rss=%.1f MB res=%s", file,
+                   strategies[k].name, run.pairs, rate, run.rss_mb, bad ? "INVALID" : "ok");
+            if (b) {
+                printf("  base pairs=%d %+.1f%%", b->pairs, change);
+                if (run.pairs < b->pairs) {
+                    printf("  FEWER PAIRS");
+                    failed = 1;
+                }
+                if (change < -tolerance) {
+                    printf("  SLOWER");
+                    failed = 1;
+                }
+            }
+            printf("\n");
+            fflush(stdout);
+            n_failed += failed;
+        }
+    }
+    fclose(csv);
+    printf("regress: %d cases, %d failed -> %s%s%s\n", n_cases, n_failed, csv_path,
+           baseline ? ", baseline " : " (no baseline)", baseline ? baseline : "");
+    free(base);
+    free_jobs(jobs, n_jobs);
+    return n_failed ? 1 : 0;
+}
+
+int lutpair_serve(const char *socket_path, char *const *paths, int n_paths, const lutpair_options *opt) {
+#if defined(LUTPAIR_THREADS) && defined(LUTPAIR_SOCKETS)
+    Job *jobs;
+    int n_jobs;
+    collect_jobs(paths, n_paths, 0, &jobs, &n_jobs);
+    int status = serve_jobs(socket_path, jobs, n_jobs, opt);
+    free_jobs(jobs, n_jobs);
+    return status;
+#else
+    (void)socket_path;
+    (void)paths;
+    (void)n_paths;
+    (void)opt;
+    fprintf(stderr, "serve needs Unix sockets and threads\n");
+    return 1;
+#endif
+}
+
+// Library stages (lutpair.h): a design is a Netlist plus its fanout index,
+// run through the same load_netlist / index_netlist / match_pairs /
+// write_* functions as a command-line testcase.
+struct lutpair_design {
+    Netlist nl;
+    FanoutIndex fx;
+    int indexed;
+    int idx;        // n of design_<n>.v, or -1; names --export-graph output
+    char *path;     // for messages; "buffer" for lutpair_load_buffer
+};
+
+void lutpair_log_free(lutpair_log *log) {
+    free(log->s);
+    log->s = NULL;
+    log->len = log->cap = 0;
+}
+
+static lutpair_design *design_new(const char *path, int idx) {
+    lutpair_design *d = (lutpair_design*)calloc(1, sizeof(lutpair_design));
+    if (!d) { fprintf(stderr, "OOM\n"); exit(1); }
+    d->idx = idx;
+    d->path = (char*)xmalloc(strlen(path) + 1);
+    strcpy(d->path, path);
+    return d;
+}
+
+lutpair_design *lutpair_load_file(const char *path, const lutpair_options *opt, lutpair_log *log) {
+    StrBuf scratch = {0};
+    int idx = -1;
+    if (!match_design_v(path, &idx)) idx = -1;
+    lutpair_design *d = design_new(path, idx);
+    RunTimes times = {0};
+    int ok = load_netlist(path, opt, &d->nl, log ? log : &scratch, &times);
+    free(scratch.s);
+    if (!ok) {
+        free(d->path);
+        free(d);
+        return NULL;
+    }
+    return d;
+}
+
+lutpair_design *lutpair_load_buffer(const char *data, size_t len, const lutpair_options *opt,
+                                    lutpair_log *log) {
+    StrBuf scratch = {0};
+    lutpair_design *d = design_new("buffer", -1);
+    netlist_setup(&d->nl, opt, 1, log ? log : &scratch);
+    if (d->nl.record_spans) {
+        // Spans point into the text; the caller keeps it alive.
+        d->nl.text.data = data;
+        d->nl.text.len = len;
+        d->nl.text.mapped = -1;
+    }
+    parse_luts_from_buffer(data, len, &d->nl);
+    netlist_derive(&d->nl, opt, log ? log : &scratch);
+    free(scratch.s);
+    return d;
+}
+
+void lutpair_build_index(lutpair_design *d) {
+    if (d->indexed) return;
+    RunTimes times = {0};
+    index_netlist(&d->nl, &d->fx, &times);
+    d->indexed = 1;
+}
+
+int lutpair_n_luts(const lutpair_design *d) {
+    return d->nl.n_luts;
+}
+
+const char *lutpair_lut_name(const lutpair_design *d, int lut) {
+    return lut >= 0 && lut < d->nl.n_luts ? d->nl.luts[lut].inst : NULL;
+}
+
+static int design_match(const lutpair_design *d, Lut *luts, const lutpair_options *opt, int *pair_a,
+                        int *pair_b, lutpair_log *log) {
+    StrBuf scratch = {0};
+    RunTimes times = {0};
+    int written;
+    int n = match_pairs(d->path, d->idx, &d->nl, luts, &d->fx, opt, NULL, now_seconds(),
+                        log ? log : &scratch, &times, pair_a, pair_b, &written);
+    free(scratch.s);
+    return n;
+}
+
+int lutpair_match(lutpair_design *d, const lutpair_options *opt, int *pair_a, int *pair_b,
+                  lutpair_log *log) {
+    lutpair_build_index(d);
+    return design_match(d, d->nl.luts, opt, pair_a, pair_b, log);
+}
+
+int lutpair_match_shared(const lutpair_design *d, const lutpair_options *opt, int *pair_a, int *pair_b,
+                         lutpair_log *log) {
+    // Sharing threads cannot build the index lazily; it must exist already.
+    if (!d->indexed) {
+        fprintf(stderr, "%s: lutpair_match_shared before lutpair_build_index\n", d->path);
+        return 0;
+    }
+    int n_luts = d->nl.n_luts;
+    Lut *work = (Lut*)xmalloc((size_t)n_luts * sizeof(Lut) + 1);
+    memcpy(work, d->nl.luts, (size_t)n_luts * sizeof(Lut));
+    int n = design_match(d, work, opt, pair_a, pair_b, log);
+    free(work);
+    return n;
+}
+
+int lutpair_write_res(const lutpair_design *d, const int *pair_a, const int *pair_b, int n_pairs,
+                      const char *path) {
+    return write_res(path, d->nl.luts, pair_a, pair_b, n_pairs);
+}
+
+int lutpair_write_netlist(const lutpair_design *d, const int *pair_a, const int *pair_b, int n_pairs,
+                          const char *path, lutpair_netlist_stats *st) {
+    lutpair_netlist_stats scratch;
+    if (!d->nl.record_spans) {
+        fprintf(stderr, "%s: netlist output needs a design loaded with --netlist\n", d->path);
+        return 0;
+    }
+    return write_netlist(path, &d->nl, pair_a, pair_b, n_pairs, st ? st : &scratch);
+}
+
+void lutpair_free(lutpair_design *d) {
+    if (!d) return;
+    if (d->indexed) free_fanout_index(&d->fx);
+    netlist_free(&d->nl);
+    free(d->path);
+    free(d);
+}
@@ -0,0 +1,144 @@
+// lutpair.h
+// LUT pairing for GTP_LUT6D packing as a library (liblutpair.a). The
+// lutpair command line (main.c) is one user; a synthesis flow can embed the
+// same stages in-process instead of writing netlists and parsing .res files:
+//
+//   lutpair_design *d = lutpair_load_file("design_3_syn.v", &opt, &log);
+//   lutpair_build_index(d);
+//   int n = lutpair_match(d, &opt, pair_a, pair_b, &log);
+//   for (int k = 0; k < n; k++)
+//       merge(lutpair_lut_name(d, pair_a[k]), lutpair_lut_name(d, pair_b[k]));
+//   lutpair_write_res(d, pair_a, pair_b, n, "design_3_syn.res");
+//   lutpair_free(d);
+//
+// Every stage works on the previous stage's output in place: a design loaded
+// with lutpair_load_buffer parses the caller's buffer directly (and, for
+// --netlist, keeps pointing into it), the index is built over the design's
+// own LUT records, and pairs go straight into the caller's arrays. LUTs are
+// numbered 0 .. lutpair_n_luts(d) - 1 in netlist order.
+#ifndef LUTPAIR_H
+#define LUTPAIR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Growable text buffer collecting the per-stage report lines the command
+// line prints ("  strategy=... pairs=..."). Start from {0}; any log argument
+// may be NULL to drop them.
+typedef struct {
+    char *s;
+    size_t len;
+    size_t cap;
+} lutpair_log;
+
+void lutpair_log_free(lutpair_log *log);
+
+enum { LUTPAIR_MATCHER_GREEDY, LUTPAIR_MATCHER_BLOSSOM, LUTPAIR_MATCHER_EXACT };
+
+#define LUTPAIR_STRATEGY_ALL (-1)
+
+// Fields mirror the command-line options (see main.c); fill it with
+// lutpair_options_init and lutpair_parse_option rather than by hand.
+// preserve_depth is read by the load stage, which levelizes the design
+// (building its net graph even without `graph`); that design is then paired
+// level-locally, while others loaded without it are not.
+typedef struct {
+    int stream;     // --stream: parse through a bounded buffer instead of mmap
+    int strategy;   // --strategy=: lutpair_find_strategy index, or LUTPAIR_STRATEGY_ALL
+    int report;     // print one line per strategy run (set by --strategy=)
+    int matcher;    // --matcher=: LUTPAIR_MATCHER_*
+    int budget_ms;  // --budget-ms=: time budget for the blossom matcher
+    int free_edges; // --free-edges=: non-sharing edges per LUT and size bucket
+    int threads;    // -j N: worker threads for graph construction
+    int graph;      // --graph: record drivers and sinks of every net
+    int preserve_depth; // --preserve-depth: levelize and keep merges level-local
+    int prune;      // --prune-inputs: drop inputs the INIT function ignores
+    const char *incremental; // --incremental=: previous .res file, or a directory of them
+    int cache;      // --cache: load/write the design_x_syn.lutc sidecar
+    int netlist;    // --netlist: also write design_x_syn_lut6d.v
+    int stats;      // --stats=json: one JSON line per testcase after its summary
+    int time_limit_ms; // --time-limit=: anytime mode, wall-clock limit per testcase
+    int export_graph; // --export-graph: write the compatibility graph as design_x_syn.dimacs
+    int compact;    // --compact: drop parsed pages of the mapping, delta-varint graph rows
+} lutpair_options;
+
+void lutpair_options_init(lutpair_options *opt);
+// Applies one single-word option ("--strategy=subset", "-j4", ...).
+// Returns 1 if it was one, 0 if not, -1 for a bad value (an unknown
+// strategy); nothing is printed.
+int lutpair_parse_option(lutpair_options *opt, const char *arg);
+int lutpair_find_strategy(const char *name);
+// Union test kernel: "avx2", "sse4.1", "scalar", or NULL for the best the
+// CPU supports. Returns the kernel in use, or NULL if `name` is unknown or
+// unsupported here.
+const char *lutpair_select_kernel(const char *name);
+
+typedef struct lutpair_design lutpair_design;
+
+// Load stage. A file is mapped (or streamed / read from the --cache
+// sidecar, as the options say); "-" reads stdin. A buffer must stay valid
+// and unchanged until lutpair_free when the design is loaded with
+// opt->netlist. Both return NULL if the input cannot be read.
+lutpair_design *lutpair_load_file(const char *path, const lutpair_options *opt, lutpair_log *log);
+lutpair_design *lutpair_load_buffer(const char *data, size_t len, const lutpair_options *opt,
+                                    lutpair_log *log);
+
+// Index stage: input signatures and the net -> LUT fanout index. Matching
+// builds it on first use if the caller has not.
+void lutpair_build_index(lutpair_design *d);
+
+int lutpair_n_luts(const lutpair_design *d);
+const char *lutpair_lut_name(const lutpair_design *d, int lut);
+
+// Match stage: runs opt->strategy (and the matcher) and writes the pairs to
+// pair_a[k], pair_b[k], which need room for lutpair_n_luts(d) / 2 entries.
+// Returns the number of pairs. lutpair_match uses the design's LUT records
+// as scratch, so one design takes one lutpair_match at a time;
+// lutpair_match_shared works on a private copy of the records and may run
+// on the same design from several threads at once.
+int lutpair_match(lutpair_design *d, const lutpair_options *opt, int *pair_a, int *pair_b,
+                  lutpair_log *log);
+int lutpair_match_shared(const lutpair_design *d, const lutpair_options *opt, int *pair_a, int *pair_b,
+                         lutpair_log *log);
+
+// Emit stage. The .res goes through a temporary file and a rename. The
+// netlist (the input with each pair merged into one GTP_LUT6D) needs a
+// design loaded with opt->netlist from a file or buffer. Both return 0 on
+// failure.
+typedef struct {
+    int merged;
+    int inexact;    // merged cells not exact on both outputs: almost always Z, whose I5 = 0
+                    // half is shared with Z5; Z5 too when both LUTs read all six (see lutpair.c)
+    int skipped;    // pairs left as two cells: no INIT, no .Z, or not a GTP_LUT<k>
+} lutpair_netlist_stats;
+
+int lutpair_write_res(const lutpair_design *d, const int *pair_a, const int *pair_b, int n_pairs,
+                      const char *path);
+int lutpair_write_netlist(const lutpair_design *d, const int *pair_a, const int *pair_b, int n_pairs,
+                          const char *path, lutpair_netlist_stats *st);
+
+void lutpair_free(lutpair_design *d);
+
+// Command-line drivers behind main.c. With no paths, lutpair_run and
+// lutpair_bench take every design_<n>.v / design_<n>_syn.v in the current
+// directory. Each returns the process exit status.
+int lutpair_run(char *const *paths, int n_paths, const lutpair_options *opt);
+int lutpair_bench(char *const *paths, int n_paths, const lutpair_options *opt, int reps, int layout);
+// Every strategy on every testcase: medians over reps (more for cases
+// under 100 ms in total) into csv_path, each .res checked, and a nonzero
+// status when a check fails or, against the baseline CSV (may be NULL),
+// pairs drop or LUTs/s falls by more than tolerance percent.
+int lutpair_regress(char *const *paths, int n_paths, const lutpair_options *opt, int reps,
+                    const char *baseline, const char *csv_path, double tolerance);
+int lutpair_serve(const char *socket_path, char *const *paths, int n_paths, const lutpair_options *opt);
+int lutpair_client(int argc, char **argv);
+int lutpair_gen(int argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif